@@ -0,0 +1,523 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <string>
+#include "CPMMachine.hpp"
+#include "emulator.h"
+#include "block_cache.h"
+#include "jit.h"
+
+// cycles per call into the core, only bounds how often the machine looks at the running flag
+#define CPM_RUN_BUDGET 1000000
+
+// FCB fields
+#define FCB_EX 12	// extent, 16K each
+#define FCB_S2 14	// extent high bits
+#define FCB_RC 15	// records in the extent
+#define FCB_CR 32	// current record in the extent
+#define FCB_SIZE 36
+
+/**
+	Counts the records of a file in an extent, what RC holds for an FCB on it. Moves the file position.
+	@param f: the file
+	@param extent: extent number, S2 * 32 + EX
+	@return records from the start of the extent, 0 to 128
+*/
+static uint8_t extent_records(FILE *f, long extent){
+	fseek(f, 0, SEEK_END);
+	long records = (ftell(f) + 127) / 128 - extent * 128;
+	return records < 0 ? 0 : (records > 128 ? 128 : records);
+}
+
+/**
+	Loads a .COM program at CPM_TPA in flat 64K memory and sets up the CP/M memory around it: OUT
+	traps at the warm boot address and at CPM_BDOS_TRAP, where the BDOS entry at 0005 jumps, and a
+	return address to warm boot on the stack. Shared by CPMMachine and the exerciser.
+	@param state: the CPU state, pc and sp are set
+	@param path: program file
+	@return 0 if the file couldn't be read
+*/
+uint8_t cpm_load_program(state_8080 *state, const char *path){
+	FILE *f = fopen(path, "rb");
+	if(f == NULL){
+		return 0;
+	}
+	fread(state->memory + CPM_TPA, 1, CPM_BDOS_TRAP - CPM_TPA, f);
+	fclose(f);
+
+	uint8_t *memory = state->memory;
+	// warm boot
+	memory[0x0000] = 0xd3;	// OUT
+	memory[0x0001] = 0x00;
+	// BDOS entry, programs also read the top of their memory from 0006
+	memory[0x0005] = 0xc3;	// JMP CPM_BDOS_TRAP
+	memory[0x0006] = CPM_BDOS_TRAP & 0xff;
+	memory[0x0007] = CPM_BDOS_TRAP >> 8;
+	memory[CPM_BDOS_TRAP] = 0xd3;	// OUT
+	memory[CPM_BDOS_TRAP + 1] = 0x00;
+	memory[CPM_BDOS_TRAP + 2] = 0xc9;	// RET
+
+	// the CCP calls programs, so a RET from the program goes to warm boot
+	state->sp = CPM_BDOS_TRAP - 2;
+	memory[state->sp] = 0x00;
+	memory[state->sp + 1] = 0x00;
+	state->pc = CPM_TPA;
+	return 1;
+}
+
+/**
+	Console output of BDOS 9: the string at addr up to '$', and never more than the 64K memory if
+	there is none. Shared by CPMMachine and the exerciser.
+	@param memory: the 8080 memory
+	@param addr: start of the string
+	@return the string, without the '$'
+*/
+std::string cpm_string(const uint8_t *memory, uint16_t addr){
+	std::string s;
+	for(uint32_t i = 0; i < 0x10000 && memory[(uint16_t)(addr + i)] != '$'; i++){
+		s += (char)memory[(uint16_t)(addr + i)];
+	}
+	return s;
+}
+
+/**
+	Initializes the CPU and the CP/M memory.
+	@param directory: host directory the file calls use
+*/
+CPMMachine::CPMMachine(const char *directory){
+	this->state = (state_8080*)calloc(sizeof(state_8080), 1);
+	this->state->memory = (uint8_t*)calloc(0x10000, 1);	// flat 64K of RAM
+	this->state->flat_memory = 1;
+	this->state->cache = block_cache_create();
+	this->state->jit = jit_create(JIT_CODE_SIZE);	// NULL on hosts without a JIT, the block cache is used then
+	this->state->cycles = 0;
+	this->state->instructions = 0;
+
+	this->dma = CPM_DEFAULT_DMA;
+	this->running = 1;
+	this->directory = directory;
+}
+
+CPMMachine::~CPMMachine(){
+	for(auto &f : this->files){
+		fclose(f.second.f);
+	}
+	jit_destroy(this->state->jit);
+	block_cache_destroy(this->state->cache);
+	free(this->state->memory);
+	free(this->state);
+}
+
+/**
+	Loads a .COM program at CPM_TPA and sets up its command line.
+	@param filename: program file
+	@param argc: number of command line arguments
+	@param argv: command line arguments for the program
+	@return 0 if the file couldn't be read
+*/
+uint8_t CPMMachine::load(const char *filename, int argc, char **argv){
+	if(!cpm_load_program(this->state, filename)){
+		return 0;
+	}
+
+	// the CCP parses the first two arguments into the default FCBs
+	this->parse_fcb(CPM_FCB1, argc > 0 ? argv[0] : "");
+	this->parse_fcb(CPM_FCB2, argc > 1 ? argv[1] : "");
+
+	// command tail in the default DMA buffer, upper case like the CCP leaves it
+	std::string tail;
+	for(int i = 0; i < argc; i++){
+		tail += ' ';
+		tail += argv[i];
+	}
+	if(tail.size() > 127){
+		tail.resize(127);
+	}
+	this->state->memory[CPM_DEFAULT_DMA] = tail.size();
+	for(uint32_t i = 0; i < tail.size(); i++){
+		this->state->memory[CPM_DEFAULT_DMA + 1 + i] = toupper(tail[i]);
+	}
+	return 1;
+}
+
+/**
+	Runs the program until it warm boots.
+*/
+void CPMMachine::run(){
+	while(this->running){
+		this->execute(CPM_RUN_BUDGET);
+	}
+}
+
+/**
+	Runs the CPU for a number of cycles, handling the BDOS calls, and advances the cycle counter.
+	@param budget: number of cycles to execute
+*/
+void CPMMachine::execute(int32_t budget){
+	int32_t cycles = 0;
+
+	while(budget > cycles && this->running){
+		uint8_t *op = this->state->memory + this->state->pc;
+		if(*op == 0xd3 || *op == 0xdb){
+			if(this->state->pc == 0x0000){
+				// warm boot
+				this->running = 0;
+				break;
+			}
+			if(this->state->pc == CPM_BDOS_TRAP){
+				this->bdos();
+			}
+			else if(*op == 0xdb){
+				// no devices, IN reads 0
+				this->state->a = 0;
+			}
+			this->state->pc += 2;
+			this->state->instructions++;
+			cycles += cycles8080[*op];
+		}
+		else{
+			cycles += emulate_8080_run_jit(this->state, budget - cycles);
+		}
+	}
+	this->state->cycles += cycles;
+}
+
+/**
+	Sets a BDOS result, in A and L for 8 bit results, HL and BA for 16 bit ones.
+	@param value: the result
+*/
+void CPMMachine::bdos_return(uint16_t value){
+	this->state->a = value & 0xff;
+	this->state->l = value & 0xff;
+	this->state->b = value >> 8;
+	this->state->h = value >> 8;
+}
+
+/**
+	Handles a BDOS call, function in C and parameter in DE. Results go to A and HL.
+*/
+void CPMMachine::bdos(){
+	uint8_t *memory = this->state->memory;
+	uint16_t de = (this->state->d << 8) | this->state->e;
+	uint16_t result = 0;
+
+	switch(this->state->c){
+		case 0:
+			// system reset
+			this->running = 0;
+			break;
+
+		case 1:{
+			// console input
+			int c = getchar();
+			result = c == EOF ? 0x1a : c;
+			break;
+		}
+
+		case 2:
+			// console output
+			putchar(this->state->e);
+			break;
+
+		case 6:
+			// direct console I/O, input never has a character ready
+			if(this->state->e < 0xfe){
+				putchar(this->state->e);
+			}
+			break;
+
+		case 9:{
+			// print string
+			std::string s = cpm_string(memory, de);
+			fwrite(s.data(), 1, s.size(), stdout);
+			break;
+		}
+
+		case 10:{
+			// read console buffer: size at DE, length read at DE+1, text after it
+			char line[256];
+			uint8_t length = 0;
+			fflush(stdout);
+			if(fgets(line, sizeof(line), stdin) != NULL){
+				while(line[length] != 0 && line[length] != '\n' && length < memory[de]){
+					write_ram(this->state, de + 2 + length, line[length]);
+					length++;
+				}
+			}
+			write_ram(this->state, de + 1, length);
+			break;
+		}
+
+		case 11:
+			// console status, no key pressed
+			break;
+
+		case 12:
+			// version, CP/M 2.2
+			result = 0x0022;
+			break;
+
+		case 13:
+			// reset disk system
+			this->dma = CPM_DEFAULT_DMA;
+			break;
+
+		case 14:
+		case 25:
+		case 32:
+			// select disk, current disk, user code: everything is on A: user 0
+			break;
+
+		case 15:{
+			// open file
+			cpm_file *file = this->fcb_file(de);
+			if(file == NULL){
+				result = 0xff;
+				break;
+			}
+			write_ram(this->state, de + FCB_CR, 0);
+			// the extent number is S2 and the low bits of EX
+			long extent = memory[(uint16_t)(de + FCB_S2)] * 32 + (memory[(uint16_t)(de + FCB_EX)] & 0x1f);
+			write_ram(this->state, de + FCB_RC, extent_records(file->f, extent));
+			break;
+		}
+
+		case 16:
+			// close file
+			this->close_file(this->fcb_path(de));
+			break;
+
+		case 17:{
+			// search for first, without wildcards: the directory entry goes to the DMA buffer
+			FILE *f = fopen(this->fcb_path(de).c_str(), "rb");
+			if(f == NULL){
+				result = 0xff;
+				break;
+			}
+			fclose(f);
+			uint8_t entry[32] = { 0 };
+			for(int i = 1; i <= 11; i++){
+				entry[i] = memory[(uint16_t)(de + i)];
+			}
+			for(int i = 0; i < 32; i++){
+				write_ram(this->state, this->dma + i, entry[i]);
+			}
+			break;
+		}
+
+		case 18:
+			// search for next, the first search found everything there is
+			result = 0xff;
+			break;
+
+		case 19:{
+			// delete file
+			std::string path = this->fcb_path(de);
+			this->close_file(path);
+			result = remove(path.c_str()) == 0 ? 0 : 0xff;
+			break;
+		}
+
+		case 20:
+			// read sequential
+			result = this->sequential(de, 0);
+			break;
+
+		case 21:
+			// write sequential
+			result = this->sequential(de, 1);
+			break;
+
+		case 22:{
+			// make file
+			std::string path = this->fcb_path(de);
+			this->close_file(path);
+			FILE *f = fopen(path.c_str(), "w+b");
+			if(f == NULL){
+				result = 0xff;
+				break;
+			}
+			this->files[path] = { f, 0 };
+			write_ram(this->state, de + FCB_EX, 0);
+			write_ram(this->state, de + FCB_S2, 0);
+			write_ram(this->state, de + FCB_RC, 0);
+			write_ram(this->state, de + FCB_CR, 0);
+			break;
+		}
+
+		case 23:{
+			// rename file, the new name is in the second half of the FCB
+			std::string from = this->fcb_path(de);
+			std::string to = this->fcb_path(de + 16);
+			this->close_file(from);
+			result = rename(from.c_str(), to.c_str()) == 0 ? 0 : 0xff;
+			break;
+		}
+
+		case 26:
+			// set DMA address
+			this->dma = de;
+			break;
+
+		default:
+			fprintf(stderr, "unsupported BDOS call %d at %04x\n", this->state->c, this->state->pc);
+			result = 0xff;
+			break;
+	}
+	this->bdos_return(result);
+}
+
+/**
+	Fills an FCB from a file name like "b:name.typ".
+	@param fcb: FCB address
+	@param name: file name
+*/
+void CPMMachine::parse_fcb(uint16_t fcb, const char *name){
+	uint8_t *memory = this->state->memory;
+
+	memset(memory + fcb, 0, FCB_SIZE);
+	memset(memory + fcb + 1, ' ', 11);
+	if(name[0] != 0 && name[1] == ':'){
+		memory[fcb] = toupper(name[0]) - 'A' + 1;
+		name += 2;
+	}
+	for(int i = 0; i < 8 && *name != 0 && *name != '.'; i++, name++){
+		memory[fcb + 1 + i] = *name == '*' ? '?' : toupper(*name);
+	}
+	while(*name != 0 && *name != '.'){
+		name++;
+	}
+	if(*name == '.'){
+		name++;
+	}
+	for(int i = 0; i < 3 && *name != 0; i++, name++){
+		memory[fcb + 9 + i] = *name == '*' ? '?' : toupper(*name);
+	}
+}
+
+/**
+	@param fcb: FCB address
+	@return the host path of the file the FCB names
+*/
+std::string CPMMachine::fcb_path(uint16_t fcb){
+	uint8_t *memory = this->state->memory;
+	std::string name;
+
+	// the drive is ignored, the high bits of the name are attributes; host names are lower case
+	for(int i = 1; i <= 11; i++){
+		char c = memory[(uint16_t)(fcb + i)] & 0x7f;
+		if(i == 9){
+			name += '.';
+		}
+		if(c != ' '){
+			name += tolower(c);
+		}
+	}
+	if(name.back() == '.'){
+		name.pop_back();
+	}
+	return this->directory + "/" + name;
+}
+
+/**
+	Opens the file an FCB names for reading and writing, or only for reading if the host doesn't
+	allow writes, or returns it if it is already open.
+	@param fcb: FCB address
+	@return the file, NULL if it doesn't exist
+*/
+cpm_file *CPMMachine::fcb_file(uint16_t fcb){
+	std::string path = this->fcb_path(fcb);
+	auto it = this->files.find(path);
+	if(it != this->files.end()){
+		return &it->second;
+	}
+
+	cpm_file file = { fopen(path.c_str(), "r+b"), 0 };
+	if(file.f == NULL){
+		// read-only files and mounts are still there to read
+		file = { fopen(path.c_str(), "rb"), 1 };
+		if(file.f == NULL){
+			return NULL;
+		}
+	}
+	return &(this->files[path] = file);
+}
+
+/**
+	Closes the file of a path if it is open.
+	@param path: host path
+*/
+void CPMMachine::close_file(const std::string &path){
+	auto it = this->files.find(path);
+	if(it != this->files.end()){
+		fclose(it->second.f);
+		this->files.erase(it);
+	}
+}
+
+/**
+	Reads or writes the record at the sequential position of an FCB and advances it.
+	@param fcb: FCB address
+	@param write: 1 to write the DMA buffer, 0 to read into it
+	@return the BDOS result, 0 if successful
+*/
+uint8_t CPMMachine::sequential(uint16_t fcb, uint8_t write){
+	uint8_t *memory = this->state->memory;
+	cpm_file *file = this->fcb_file(fcb);
+	if(file == NULL){
+		return write ? 2 : 1;
+	}
+	if(write && file->read_only){
+		// disk full is the only write error CP/M 2.2 has
+		return 2;
+	}
+	FILE *f = file->f;
+
+	uint8_t ex = memory[(uint16_t)(fcb + FCB_EX)];
+	uint8_t s2 = memory[(uint16_t)(fcb + FCB_S2)];
+	uint8_t cr = memory[(uint16_t)(fcb + FCB_CR)];
+	long record = ((s2 * 32) + (ex & 0x1f)) * 128 + cr;
+	uint8_t buffer[128];
+
+	fseek(f, record * 128, SEEK_SET);
+	if(write){
+		for(int i = 0; i < 128; i++){
+			buffer[i] = memory[(uint16_t)(this->dma + i)];
+		}
+		if(fwrite(buffer, 1, 128, f) != 128){
+			return 2;
+		}
+		if(memory[(uint16_t)(fcb + FCB_RC)] <= cr){
+			write_ram(this->state, fcb + FCB_RC, cr + 1);
+		}
+	}
+	else{
+		size_t n = fread(buffer, 1, 128, f);
+		if(n == 0){
+			// end of file
+			return 1;
+		}
+		// the last record of a text file is padded with ^Z
+		memset(buffer + n, 0x1a, 128 - n);
+		// through write_ram, a program reading an overlay over code it ran must not run the old blocks
+		for(int i = 0; i < 128; i++){
+			write_ram(this->state, this->dma + i, buffer[i]);
+		}
+	}
+
+	if(++cr == 128){
+		cr = 0;
+		if(++ex == 32){
+			ex = 0;
+			s2++;
+		}
+		write_ram(this->state, fcb + FCB_EX, ex);
+		write_ram(this->state, fcb + FCB_S2, s2);
+		// RC of the next extent, like open computes it: 0 for a write past the end of the file
+		write_ram(this->state, fcb + FCB_RC, extent_records(f, s2 * 32 + ex));
+	}
+	write_ram(this->state, fcb + FCB_CR, cr);
+	return 0;
+}
@@ -0,0 +1,132 @@
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+#include "emulator.h"
+
+#pragma once
+
+// CP/M memory map
+#define CPM_TPA 0x0100			// programs are loaded and started here
+#define CPM_BDOS_TRAP 0xfe00	// the BDOS entry at 0005 jumps here, also the top of the program memory
+#define CPM_DEFAULT_DMA 0x0080
+#define CPM_FCB1 0x005c
+#define CPM_FCB2 0x006c
+
+/**
+	Loads a .COM program at CPM_TPA in flat 64K memory and sets up the CP/M memory around it: OUT
+	traps at the warm boot address and at CPM_BDOS_TRAP, where the BDOS entry at 0005 jumps, and a
+	return address to warm boot on the stack. Shared by CPMMachine and the exerciser.
+	@param state: the CPU state, pc and sp are set
+	@param path: program file
+	@return 0 if the file couldn't be read
+*/
+uint8_t cpm_load_program(state_8080 *state, const char *path);
+
+/**
+	Console output of BDOS 9: the string at addr up to '$', and never more than the 64K memory if
+	there is none. Shared by CPMMachine and the exerciser.
+	@param memory: the 8080 memory
+	@param addr: start of the string
+	@return the string, without the '$'
+*/
+std::string cpm_string(const uint8_t *memory, uint16_t addr);
+
+/**
+	A host file opened by the file calls.
+*/
+typedef struct cpm_file{
+	FILE *f;
+	uint8_t read_only;	// 1 if the host only lets it be read
+} cpm_file;
+
+/**
+	CP/M Machine class. Runs .COM programs in flat 64K RAM with the BDOS console and sequential
+	file calls emulated on the host, as fast as the host allows.
+
+	The BDOS entry and the warm boot address hold OUT instructions, so the cores return to the
+	machine on BDOS calls like on any OUT and nothing is checked per instruction.
+*/
+struct CPMMachine{
+	state_8080 *state;
+
+	uint16_t dma;		// record buffer of the file calls
+	uint8_t running;	// 0 after a warm boot
+
+	std::string directory;					// host directory of the CP/M files
+	std::map<std::string, cpm_file> files;	// open files, by host path
+
+	/**
+		Initializes the CPU and the CP/M memory.
+		@param directory: host directory the file calls use
+	*/
+	CPMMachine(const char *directory);
+
+	~CPMMachine();
+
+	/**
+		Loads a .COM program at CPM_TPA and sets up its command line.
+		@param filename: program file
+		@param argc: number of command line arguments
+		@param argv: command line arguments for the program
+		@return 0 if the file couldn't be read
+	*/
+	uint8_t load(const char *filename, int argc, char **argv);
+
+	/**
+		Runs the program until it warm boots.
+	*/
+	void run();
+
+	/**
+		Runs the CPU for a number of cycles, handling the BDOS calls, and advances the cycle counter.
+		@param budget: number of cycles to execute
+	*/
+	void execute(int32_t budget);
+
+	/**
+		Handles a BDOS call, function in C and parameter in DE. Results go to A and HL.
+	*/
+	void bdos();
+
+	/**
+		Sets a BDOS result, in A and L for 8 bit results, HL and BA for 16 bit ones.
+		@param value: the result
+	*/
+	void bdos_return(uint16_t value);
+
+	/**
+		Fills an FCB from a file name like "b:name.typ".
+		@param fcb: FCB address
+		@param name: file name
+	*/
+	void parse_fcb(uint16_t fcb, const char *name);
+
+	/**
+		@param fcb: FCB address
+		@return the host path of the file the FCB names
+	*/
+	std::string fcb_path(uint16_t fcb);
+
+	/**
+		Opens the file an FCB names for reading and writing, or only for reading if the host doesn't
+		allow writes, or returns it if it is already open.
+		@param fcb: FCB address
+		@return the file, NULL if it doesn't exist
+	*/
+	cpm_file *fcb_file(uint16_t fcb);
+
+	/**
+		Closes the file of a path if it is open.
+		@param path: host path
+	*/
+	void close_file(const std::string &path);
+
+	/**
+		Reads or writes the record at the sequential position of an FCB and advances it.
+		@param fcb: FCB address
+		@param write: 1 to write the DMA buffer, 0 to read into it
+		@return the BDOS result, 0 if successful
+	*/
+	uint8_t sequential(uint16_t fcb, uint8_t write);
+};
@@ -1,37 +1,44 @@
-#include <SDL2/SDL.h>
 #include <cstdint>
+#include "emulator.h"
 
 #pragma once
 
 /**
-	Display class. Wraps the SDL2 interactions.
+	Display interface. Shows the frames of the machine and reads the player input.
 */
 struct Display{
-	SDL_Window *window = NULL;
-	SDL_Renderer *renderer = NULL;
-	SDL_Texture *sdlTexture = NULL;
-
-	uint32_t pixels[256*224];
-
-public:
-	Display();
+	virtual ~Display(){}
 
 	/**
-		Sets a certain pixel to be white or black.
-		@param x: column
-		@param y: row
-	*/
-	void set_pixel(uint32_t x, uint32_t y, uint8_t pixel);
-
-	/**
-		Loops over the memory mapped video RAM to translate it to the SDL2 screen.
+		Updates the screen.
 		@param arr: Space Invaders screen memory map
+		@param dirty: VRAM_COLUMNS bits, 1 for the columns written since the previous frame
 	*/
-	void update_surface(uint8_t *arr);
+	virtual void show_frame(uint8_t *arr, const uint32_t *dirty) = 0;
 
 	/**
-		Updates the screen.
-		@param arr: Space Invaders screen memory map
+		Processes the pending input events.
+		@param in_port1: input port 1 of the machine, updated with the pressed keys
+		@return 0 if the user asked to quit
 	*/
-	void show_frame(uint8_t *arr);
+	virtual uint8_t handle_events(uint8_t *in_port1) = 0;
+};
+
+/**
+	Display that shows nothing and has no input, for headless runs.
+*/
+struct NullDisplay : Display{
+	uint64_t frames = 0;	// frames shown
+	uint64_t columns = 0;	// VRAM columns written, over all frames
+
+	void show_frame(uint8_t *arr, const uint32_t *dirty) override{
+		this->frames++;
+		for(uint32_t i = 0; i < VRAM_COLUMNS / 32; i++){
+			this->columns += __builtin_popcount(dirty[i]);
+		}
+	}
+
+	uint8_t handle_events(uint8_t *in_port1) override{
+		return 1;
+	}
 };
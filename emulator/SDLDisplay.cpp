@@ -0,0 +1,216 @@
+#include <SDL2/SDL.h>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include "SDLDisplay.hpp"
+#include "video.h"
+
+const int WIDTH = VIDEO_WIDTH;
+const int HEIGHT = VIDEO_HEIGHT;
+const int DISPLAY_WIDTH = 896;
+const int DISPLAY_HEIGHT = 1024;
+
+/**
+	@param cpu_rotate: 1 to rotate and expand the screen on the CPU, 0 to let the renderer rotate it
+*/
+SDLDisplay::SDLDisplay(uint8_t cpu_rotate){
+	this->cpu_rotate = cpu_rotate;
+	if(SDL_Init(SDL_INIT_VIDEO) < 0){
+		printf("SDL could not initialize! Error: %s\n", SDL_GetError());
+		exit(1);
+	}
+
+	this->window = SDL_CreateWindow("Space Invaders", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, DISPLAY_WIDTH, DISPLAY_HEIGHT,
+									SDL_WINDOW_SHOWN);
+	if(window == NULL){
+		printf("SDL could not create window! Error: %s\n", SDL_GetError());
+		exit(1);
+	}
+
+	// The renderer lives on its own thread. SDL2 only promises the render API on the main thread:
+	// this works on Linux (X11, Wayland, KMSDRM), but not on macOS, where Cocoa needs the main
+	// thread, nor with some Direct3D setups. A port there has to move the emulation to a worker
+	// thread and render on the main one instead.
+#if !defined(__linux__)
+#warning "SDLDisplay renders from a secondary thread, which SDL2 only supports on Linux"
+#endif
+	frame_exchange_init(&this->frames);
+	this->running = true;
+	this->render_thread = std::thread(&SDLDisplay::render, this);
+}
+
+SDLDisplay::~SDLDisplay(){
+	this->running = false;
+	this->render_thread.join();
+	SDL_DestroyWindow(this->window);
+	SDL_Quit();
+}
+
+/**
+	Render thread: shows the latest frame put by show_frame until the display is destroyed.
+*/
+void SDLDisplay::render(){
+	using namespace std::this_thread;
+	using namespace std::chrono;
+
+	// a renderer belongs to the thread that created it
+	renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_PRESENTVSYNC);
+	if(renderer == NULL){
+		// no renderer with vsync, the software one on hosts without a GPU may not have it
+		renderer = SDL_CreateRenderer(window, -1, 0);
+	}
+	if(renderer == NULL){
+		// handle_events sees running drop and the emulator quits
+		printf("SDL could not create a renderer on the render thread! Error: %s\n", SDL_GetError());
+		this->running = false;
+		return;
+	}
+	SDL_RenderSetLogicalSize(renderer, WIDTH, HEIGHT);
+
+	if(this->cpu_rotate){
+		sdlTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+									SDL_TEXTUREACCESS_STREAMING,
+									WIDTH, HEIGHT);
+	}
+	else{
+		// as the VRAM lays it out, sideways
+		sdlTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGB332,
+									SDL_TEXTUREACCESS_STREAMING,
+									HEIGHT, WIDTH);
+	}
+
+	while(this->running){
+		const frame *f = frame_exchange_take(&this->frames);
+		if(f == NULL){
+			sleep_for(milliseconds(1));
+			continue;
+		}
+		this->present(f);
+	}
+
+	SDL_DestroyTexture(this->sdlTexture);
+	SDL_DestroyRenderer(this->renderer);
+}
+
+/**
+	Converts and uploads the columns of a frame that changed, then presents it.
+	@param f: the frame
+*/
+void SDLDisplay::present(const frame *f){
+	video_span spans[VIDEO_MAX_SPANS];
+	SDL_RenderClear(renderer);
+
+	if(this->cpu_rotate){
+		uint32_t count = video_update_dirty(f->vram, this->pixels, f->dirty, spans);
+		for(uint32_t i = 0; i < count; i++){
+			SDL_Rect rect = { spans[i].first, 0, spans[i].end - spans[i].first, HEIGHT };
+			SDL_UpdateTexture(sdlTexture, &rect, pixels + spans[i].first, WIDTH * sizeof(uint32_t));
+		}
+		SDL_RenderCopy(renderer, sdlTexture, NULL, NULL);
+	}
+	else{
+		// columns of the screen are rows of the texture
+		uint32_t count = video_update_bytes(f->vram, this->bytes, f->dirty, spans);
+		for(uint32_t i = 0; i < count; i++){
+			SDL_Rect rect = { 0, spans[i].first, HEIGHT, spans[i].end - spans[i].first };
+			SDL_UpdateTexture(sdlTexture, &rect, bytes + spans[i].first * HEIGHT, HEIGHT);
+		}
+		// turned a quarter counterclockwise about the centre of the screen: the bottom of a
+		// column (bit 0 of its first byte) ends up at the bottom left
+		SDL_Rect sideways = { (WIDTH - HEIGHT) / 2, (HEIGHT - WIDTH) / 2, HEIGHT, WIDTH };
+		SDL_RenderCopyEx(renderer, sdlTexture, NULL, &sideways, 270.0, NULL, SDL_FLIP_NONE);
+	}
+	SDL_RenderPresent(renderer);
+}
+
+/**
+	Hands the screen to the render thread, which converts and uploads only the columns that changed.
+	@param arr: Space Invaders screen memory map
+	@param dirty: VRAM_COLUMNS bits, 1 for the columns written since the previous frame
+*/
+void SDLDisplay::show_frame(uint8_t *arr, const uint32_t *dirty){
+	frame_exchange_put(&this->frames, arr, dirty);
+}
+
+/**
+	Processes the pending SDL events.
+	@param in_port1: input port 1 of the machine, updated with the pressed keys
+	@return 0 if the user asked to quit or the render thread couldn't start
+*/
+uint8_t SDLDisplay::handle_events(uint8_t *in_port1){
+	SDL_Event event;
+
+	if(!this->running){
+		// the render thread gave up
+		return 0;
+	}
+
+	while(SDL_PollEvent(&event)){
+		switch(event.type){
+			case SDL_QUIT:
+				return 0;
+
+			case SDL_KEYDOWN:
+				switch(event.key.keysym.scancode){
+					case SDL_SCANCODE_LEFT:
+						// left
+						*in_port1 |= 0x20;
+						break;
+					case SDL_SCANCODE_RIGHT:
+						// right
+						*in_port1 |= 0x40;
+						break;
+					case SDL_SCANCODE_SPACE:
+						// fire
+						*in_port1 |= 0x10;
+						break;
+					case SDL_SCANCODE_E:
+						// start p1
+						*in_port1 |= 0x4;
+						break;
+					case SDL_SCANCODE_C:
+						// coin
+						*in_port1 |= 0x1;
+						break;
+					case SDL_SCANCODE_Q:
+						// quit
+						return 0;
+					default:
+						break;
+					}
+				break;
+
+			case SDL_KEYUP:
+				switch(event.key.keysym.scancode){
+					case SDL_SCANCODE_LEFT:
+						// left
+						*in_port1 &= ~0x20;
+						break;
+					case SDL_SCANCODE_RIGHT:
+						// right
+						*in_port1 &= ~0x40;
+						break;
+					case SDL_SCANCODE_SPACE:
+						// fire
+						*in_port1 &= ~0x10;
+						break;
+					case SDL_SCANCODE_E:
+						// start p1
+						*in_port1 &= ~0x4;
+						break;
+					case SDL_SCANCODE_C:
+						// coin
+						*in_port1 &= ~0x1;
+						break;
+					default:
+						break;
+					}
+				break;
+			default:
+				break;
+		}
+	}
+	return 1;
+}
@@ -0,0 +1,68 @@
+#include <SDL2/SDL.h>
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include "Display.hpp"
+#include "frame_exchange.h"
+#include "video.h"
+
+#pragma once
+
+/**
+	SDL2 display. Shows the frames in a window and reads the keyboard.
+
+	The emulation thread only copies the screen into a frame_exchange at vblank. A render thread
+	owns the renderer and does the conversion, upload and present, so a present blocked on vsync
+	or the compositor never delays the emulation. Events stay on the thread that created the window.
+	Rendering off the main thread is only supported by SDL2 on Linux, see the constructor.
+
+	By default the texture is the unrotated screen at one byte per pixel (RGB332), 256x224 as the
+	VRAM lays it out, and SDL_RenderCopyEx rotates it when presenting, which the software renderer
+	does too. cpu_rotate converts to an upright ARGB8888 texture on the CPU instead.
+*/
+struct SDLDisplay : Display{
+	SDL_Window *window = NULL;
+	SDL_Renderer *renderer = NULL;		// render thread only
+	SDL_Texture *sdlTexture = NULL;		// render thread only
+
+	uint8_t cpu_rotate;					// 1 for the upright ARGB8888 texture
+	alignas(VIDEO_ALIGN) uint32_t pixels[VIDEO_WIDTH*VIDEO_HEIGHT];	// render thread only, cpu_rotate
+	uint8_t bytes[VIDEO_HEIGHT*VIDEO_WIDTH];	// render thread only, unrotated
+
+	frame_exchange frames;
+	std::atomic<bool> running;
+	std::thread render_thread;
+
+public:
+	/**
+		@param cpu_rotate: 1 to rotate and expand the screen on the CPU, 0 to let the renderer rotate it
+	*/
+	SDLDisplay(uint8_t cpu_rotate = 0);
+
+	~SDLDisplay();
+
+	/**
+		Render thread: shows the latest frame put by show_frame until the display is destroyed.
+	*/
+	void render();
+
+	/**
+		Converts and uploads the columns of a frame that changed, then presents it.
+		@param f: the frame
+	*/
+	void present(const frame *f);
+
+	/**
+		Hands the screen to the render thread, which converts and uploads only the columns that changed.
+		@param arr: Space Invaders screen memory map
+		@param dirty: VRAM_COLUMNS bits, 1 for the columns written since the previous frame
+	*/
+	void show_frame(uint8_t *arr, const uint32_t *dirty) override;
+
+	/**
+		Processes the pending SDL events.
+		@param in_port1: input port 1 of the machine, updated with the pressed keys
+		@return 0 if the user asked to quit or the render thread couldn't start
+	*/
+	uint8_t handle_events(uint8_t *in_port1) override;
+};
@@ -3,20 +3,48 @@
 #include <thread>
 #include <string>
 #include <iostream>
-#include <SDL2/SDL.h>
+#include <cstring>
 #include "SIMachine.hpp"
 #include "Display.hpp"
 #include "emulator.h"
+#include "block_cache.h"
+#include "jit.h"
+#include "recompiled.h"
+#include "scheduler.h"
+#include "pacer.h"
+#include "opcode_stats.h"
+#include "pc_profile.h"
+#include "callgraph.h"
+#include "trace.h"
 
 /**
-	Initializes the CPU, Display and reads ROM files.
+	Initializes the CPU and reads ROM files.
+	@param display: where the frames go, owned by the caller
 */
-SIMachine::SIMachine(){
+SIMachine::SIMachine(Display *display){
 	this->state = (state_8080*)calloc(sizeof(state_8080), 1);
-	this->state->memory = (uint8_t*)malloc(65535);	// allocate the whole memory map
+	this->state->memory = (uint8_t*)calloc(0x10000, 1);	// allocate the whole memory map
+	this->state->cache = block_cache_create();
+#if STATIC_RECOMPILED
+	this->state->jit = NULL;
+	recompiled_init();
+	this->core = emulate_8080_run_recompiled;
+#else
+	this->state->jit = jit_create(JIT_CODE_SIZE);	// NULL on hosts without a JIT, the block cache is used then
+	this->core = emulate_8080_run_jit;
+#endif
 	this->state->pc = 0;
 	this->state->sp = 0xf000;
-	this->last_timer = 0.0;
+	this->state->cycles = 0;
+	this->state->instructions = 0;
+	memset(this->state->vram_dirty, 0xff, sizeof(this->state->vram_dirty));	// the first frame draws everything
+
+	scheduler_init(&this->events);
+	this->frame = 0;
+	this->pending_int = 0;
+	this->schedule_frame();
+	this->turbo = 0;
+	this->profile = NULL;
 
 	this->state->int_enable = 1;
 	this->state->a = 0;
@@ -27,162 +55,303 @@ SIMachine::SIMachine(){
 	this->state->h = 0;
 	this->state->l = 0;
 
+	this->shift0 = 0;
+	this->shift1 = 0;
+	this->shift_offset = 0;
+	this->in_port1 = 0;
+
 	this->read_2_memory("invaders/invaders.h", 0x0);
 	this->read_2_memory("invaders/invaders.g", 0x800);
 	this->read_2_memory("invaders/invaders.f", 0x1000);
 	this->read_2_memory("invaders/invaders.e", 0x1800);
 
-	this->display = new Display();
+	this->display = display;
 	// for(int i = 0; i < 8192; i++){
 	// 	this->rom_save[i] = this->state->memory[i];
 	// }
 }
 
 SIMachine::~SIMachine(){
+	if(this->profile != NULL){
+		pc_profile_destroy(this->profile);
+	}
+	if(this->state->stats != NULL){
+		opcode_stats_destroy(this->state->stats);
+	}
+	if(this->state->calls != NULL){
+		callgraph_destroy(this->state->calls);
+	}
+	if(this->state->trace != NULL){
+		trace_destroy(this->state->trace);
+	}
+	jit_destroy(this->state->jit);
+	block_cache_destroy(this->state->cache);
 	free(this->state->memory);
 	free(this->state);
 }
 
 /**
-	Runs an infinite loop with the game.
+	Switches to the instrumented core, which counts every opcode in state->stats. Slower than
+	the default core, but the emulation is the same.
+*/
+void SIMachine::count_opcodes(){
+	if(this->state->stats == NULL){
+		this->state->stats = opcode_stats_create();
+	}
+	this->core = emulate_8080_run_stats;
+}
+
+/**
+	Switches to the instrumented core, which follows CALL, RET and the interrupts to build a
+	call graph in state->calls.
+*/
+void SIMachine::profile_calls(){
+	if(this->state->calls == NULL){
+		this->state->calls = callgraph_create();
+	}
+	this->core = emulate_8080_run_stats;
+}
+
+/**
+	Switches to the instrumented core and records every instruction into a trace file, which
+	keeps the last records if the emulator dies.
+	@param path: trace file, NULL to keep the records in memory only
+	@param records: number of instructions to keep
+	@return 0 if the file couldn't be created
+*/
+uint8_t SIMachine::trace_to(const char *path, uint32_t records){
+	if(this->state->trace == NULL){
+		this->state->trace = trace_create(path, records);
+		if(this->state->trace == NULL){
+			return 0;
+		}
+	}
+	this->core = emulate_8080_run_stats;
+	return 1;
+}
+
+/**
+	Starts sampling PC into this->profile.
+	@param interval: emulated cycles between samples
+*/
+void SIMachine::profile_pc(uint32_t interval){
+	if(this->profile != NULL){
+		return;
+	}
+	this->profile = pc_profile_create(interval, this->state->cycles);
+	scheduler_add(&this->events, this->profile->next, EVENT_PC_SAMPLE);
+}
+
+/**
+	Saves the machine state.
+	@param s: where to save it
+*/
+void SIMachine::save(SISnapshot *s){
+	materialize_flags(this->state);
+	s->cpu = *this->state;
+	memcpy(s->memory, this->state->memory, sizeof(s->memory));
+	s->events = this->events;
+	s->frame = this->frame;
+	s->pending_int = this->pending_int;
+	s->shift0 = this->shift0;
+	s->shift1 = this->shift1;
+	s->shift_offset = this->shift_offset;
+	s->in_port1 = this->in_port1;
+}
+
+/**
+	Puts the machine back in a saved state. The decoded blocks are dropped, as the code in
+	memory may differ.
+	@param s: the saved state, from this machine or one with the same ROM
+*/
+void SIMachine::restore(const SISnapshot *s){
+	state_8080 cpu = s->cpu;
+	cpu.memory = this->state->memory;
+	cpu.cache = this->state->cache;
+	cpu.jit = this->state->jit;
+	cpu.stats = this->state->stats;
+	cpu.calls = this->state->calls;
+	cpu.trace = this->state->trace;
+	*this->state = cpu;
+
+	memcpy(this->state->memory, s->memory, sizeof(s->memory));
+	memset(this->state->vram_dirty, 0xff, sizeof(this->state->vram_dirty));
+	block_cache_flush(this->state->cache);
+	this->events = s->events;
+	this->frame = s->frame;
+	this->pending_int = s->pending_int;
+	this->shift0 = s->shift0;
+	this->shift1 = s->shift1;
+	this->shift_offset = s->shift_offset;
+	this->in_port1 = s->in_port1;
+}
+
+/**
+	Runs the game until the display asks to quit.
 */
 void SIMachine::start_emulation(){
 	using namespace std::this_thread;
 	using namespace std::chrono;
 
-	while(1){
-		SDL_Event event;
-
-		if(SDL_PollEvent(&event)){
-			switch(event.type){
-				case SDL_KEYDOWN:
-					switch(event.key.keysym.scancode){
-						case SDL_SCANCODE_LEFT:
-							// left
-							this->in_port1 |= 0x20;
-							break;
-						case SDL_SCANCODE_RIGHT:
-							// right
-							this->in_port1 |= 0x40;
-							break;
-						case SDL_SCANCODE_SPACE:
-							// fire
-							this->in_port1 |= 0x10;
-							break;
-						case SDL_SCANCODE_E:
-							// start p1
-							this->in_port1 |= 0x4;
-							break;
-						case SDL_SCANCODE_C:
-							// coin
-							this->in_port1 |= 0x1;
-							break;
-						case SDL_SCANCODE_Q:
-							// coin
-							SDL_DestroyWindow(this->display->window);
-							SDL_Quit();
-							exit(1);
-							break;
-						default:
-							break;
-						}
-					break;
-
-				case SDL_KEYUP:
-					switch(event.key.keysym.scancode){
-						case SDL_SCANCODE_LEFT:
-							// left
-							this->in_port1 &= ~0x20;
-							break;
-						case SDL_SCANCODE_RIGHT:
-							// right
-							this->in_port1 &= ~0x40;
-							break;
-						case SDL_SCANCODE_SPACE:
-							// fire
-							this->in_port1 &= ~0x10;
-							break;
-						case SDL_SCANCODE_E:
-							// start p1
-							this->in_port1 &= ~0x4;
-							break;
-						case SDL_SCANCODE_C:
-							// coin
-							this->in_port1 &= ~0x1;
-							break;
-						default:
-							break;
-						}
-					break;
-				default:
-					break;
-			}
-		}
+	if(this->turbo){
+		this->run_turbo();
+		return;
+	}
+
+	// the host may fall two frames behind before the pacer drops time
+	pacer_start(&this->pacing, CPU_HZ, this->state->cycles, 2 * CPU_HZ / FRAME_HZ);
 
+	while(this->display->handle_events(&this->in_port1)){
 		this->run();
 		sleep_for(milliseconds(1));
 	}
 }
 
 /**
-	Runs the CPU and triggers the interrupts if it is the case.
+	Runs the CPU up to the cycle count released by the pacer.
 */
 void SIMachine::run(){
+	this->run_until(pacer_release(&this->pacing, this->state->cycles));
+}
+
+/**
+	Runs frames back to back as fast as the host allows, printing the speed every second.
+	Interrupts still fire at their emulated cycles, only the pacing is gone.
+*/
+void SIMachine::run_turbo(){
 	using namespace std::chrono;
 
-	// get current time from epoch in microseconds
-	double now = duration_cast<microseconds>(high_resolution_clock::now().time_since_epoch()).count();
+	steady_clock::time_point last = steady_clock::now();
+	uint64_t last_cycles = this->state->cycles;
+	uint64_t last_instructions = this->state->instructions;
+	uint64_t last_frame = this->frame;
 
-	// first execution
-	if(this->last_timer == 0.0){
-		this->last_timer = now;
-		this->next_int = this->last_timer + 16000.0;	// 16 milliseconds from now (60FPS)
-		this->which_int = 1;
-	}
+	while(this->display->handle_events(&this->in_port1)){
+		// to the end of the current frame
+		this->run_until((this->frame + 1) * CPU_HZ / FRAME_HZ);
 
-	if((this->state->int_enable) && (now > this->next_int)){
-		// switches between interrupts
-		// 1 in the middle of the frame, 2 at the end
-		if(this->which_int == 1){
-			generate_interrupt(this->state, 1);
-			this->which_int = 2;
+		steady_clock::time_point now = steady_clock::now();
+		double ns = duration<double, std::nano>(now - last).count();
+		if(ns >= 1e9){
+			uint64_t instructions = this->state->instructions - last_instructions;
+			printf("%.2f MHz, %.1f fps, %.2f ns per instruction\n",
+					(this->state->cycles - last_cycles) * 1e3 / ns,
+					(this->frame - last_frame) * 1e9 / ns,
+					instructions ? ns / instructions : 0.0);
+			last = now;
+			last_cycles = this->state->cycles;
+			last_instructions = this->state->instructions;
+			last_frame = this->frame;
 		}
-		else{
-			generate_interrupt(this->state, 2);
-			this->which_int = 1;
-			this->display->show_frame(this->get_framebuffer());	// update screen
+	}
+}
+
+/**
+	Runs the CPU and the scheduled events up to a cycle count. Everything happens at fixed
+	emulated cycles, so the result doesn't depend on how the host splits the run into calls.
+	@param target: cycle count to run to
+*/
+void SIMachine::run_until(uint64_t target){
+	while(this->state->cycles < target){
+		uint64_t next = scheduler_next(&this->events);
+		uint64_t until = next < target ? next : target;
+		if(this->state->cycles < until){
+			this->execute(until - this->state->cycles);
 		}
 
-		this->next_int = now + 8000.0; 	// half a frame
+		uint32_t type;
+		while(scheduler_pop(&this->events, this->state->cycles, &type)){
+			this->handle_event(type);
+		}
+		this->deliver_interrupt();
 	}
+}
 
-	// calculate how many cycles have passed to execute the needed number of instructions
-	// this emulates the 2MHz clock of the machine
-	double since_last = now - this->last_timer;
-	int32_t cycles_to_execute = 2 * since_last;
-	int32_t cycles = 0;
+/**
+	Runs the CPU for a number of cycles, handling the I/O instructions, and advances the cycle counter.
+	The counter is advanced after every core run, so the cores see the cycle count they start at.
+	@param budget: number of cycles to execute
+*/
+void SIMachine::execute(int32_t budget){
+	uint64_t end = this->state->cycles + budget;
 
-	while(cycles_to_execute > cycles){
+	while(this->state->cycles < end){
 		uint8_t *op;
 		op = this->state->memory + this->state->pc;
-		if(*op == 0xdb){
-			// IN
-			this->state->a = this->input_SI(op[1]);
-			this->state->pc += 2;
-			cycles += 3;
-		}
-		else if(*op == 0xd3){
-			// OUT
-			this->output_SI(op[1], this->state->a);
+		if(*op == 0xdb || *op == 0xd3){
+			if(this->state->trace != NULL){
+				materialize_flags(this->state);
+				trace_add(this->state->trace, this->state, this->state->pc, this->state->cycles);
+			}
+			if(*op == 0xdb){
+				// IN
+				this->state->a = this->input_SI(op[1]);
+			}
+			else{
+				// OUT
+				this->output_SI(op[1], this->state->a);
+			}
 			this->state->pc += 2;
-			cycles += 3;
+			this->state->instructions++;
+			this->state->cycles += 3;
+			if(this->state->stats != NULL){
+				opcode_stats_count(this->state->stats, *op, 3);
+			}
+			if(this->state->calls != NULL){
+				callgraph_cycles(this->state->calls, 3);
+			}
 		}
 		else{
-			cycles += emulate_8080_op(this->state);
+			this->state->cycles += this->core(this->state, end - this->state->cycles);
+			// the core returns after EI, a pending interrupt is taken right away
+			this->deliver_interrupt();
 		}
 	}
+}
+
+/**
+	Queues the interrupts of the current frame: RST 1 in the middle of the screen, RST 2 at vblank.
+	Frame n starts at cycle n * CPU_HZ / FRAME_HZ, so the fractional cycles per frame don't drift.
+*/
+void SIMachine::schedule_frame(){
+	uint64_t start = this->frame * CPU_HZ / FRAME_HZ;
+	uint64_t end = (this->frame + 1) * CPU_HZ / FRAME_HZ;
+
+	scheduler_add(&this->events, start + (end - start) / 2, EVENT_MID_SCREEN);
+	scheduler_add(&this->events, end, EVENT_VBLANK);
+}
 
-	this->last_timer = now;
+/**
+	Handles a due event.
+	@param type: the event (enum machine_event)
+*/
+void SIMachine::handle_event(uint32_t type){
+	switch(type){
+		case EVENT_MID_SCREEN:
+			this->pending_int = 1;
+			break;
+		case EVENT_VBLANK:
+			this->pending_int = 2;
+			this->display->show_frame(this->get_framebuffer(), this->state->vram_dirty);	// update screen
+			memset(this->state->vram_dirty, 0, sizeof(this->state->vram_dirty));
+			this->frame++;
+			this->schedule_frame();
+			break;
+		case EVENT_PC_SAMPLE:
+			pc_profile_sample(this->profile, this->state->pc);
+			scheduler_add(&this->events, this->profile->next, EVENT_PC_SAMPLE);
+			break;
+	}
+}
+
+/**
+	Takes the pending interrupt if interrupts are enabled. Otherwise it stays pending until EI.
+*/
+void SIMachine::deliver_interrupt(){
+	if(this->pending_int && this->state->int_enable){
+		generate_interrupt(this->state, this->pending_int);
+		this->pending_int = 0;
+	}
 }
 
 /**
@@ -2,19 +2,48 @@
 #include <cstdint>
 #include "Display.hpp"
 #include "emulator.h"
+#include "scheduler.h"
+#include "pacer.h"
+#include "pc_profile.h"
 
 #pragma once
 
+// emulated CPU clock and screen refresh rate
+#define CPU_HZ 2000000
+#define FRAME_HZ 60
+
+// scheduler events
+enum machine_event{ EVENT_MID_SCREEN, EVENT_VBLANK, EVENT_PC_SAMPLE };
+
+/**
+	Machine state at a point in time, everything run_until depends on.
+*/
+struct SISnapshot{
+	state_8080 cpu;				// registers and counters, the pointers in it are not restored
+	uint8_t memory[0x10000];
+	scheduler events;
+	uint64_t frame;
+	uint8_t pending_int;
+	uint8_t shift0;
+	uint8_t shift1;
+	uint8_t shift_offset;
+	uint8_t in_port1;
+};
+
 /**
 	Space Invaders Machine class. Emulates the arcade machine hardware.
 */
 struct SIMachine{
 	state_8080 *state;
+	int32_t (*core)(state_8080 *state, int32_t budget);	// CPU core execute runs, picked at startup
 
-	// timers for the interrupts
-	double last_timer;
-	double next_int;
-	uint8_t which_int;
+	// emulated time
+	scheduler events;		// interrupts, at CPU cycle counts
+	uint64_t frame;			// frames started
+	uint8_t pending_int;	// interrupt raised while interrupts were disabled, 0 if none
+	pacer pacing;			// releases cycles following the wall clock
+	uint8_t turbo;			// 1 to run frames back to back instead of following the wall clock
+	pc_profile *profile;	// PC samples, NULL if not profiling
 
 	// shift register variables
 	uint8_t shift0;
@@ -25,9 +54,10 @@ struct SIMachine{
 	Display *display;
 
 	/**
-		Initializes the CPU, Display and reads ROM files.
+		Initializes the CPU and reads ROM files.
+		@param display: where the frames go, owned by the caller
 	*/
-	SIMachine();
+	SIMachine(Display *display);
 
 	~SIMachine();
 
@@ -39,12 +69,87 @@ struct SIMachine{
 	void read_2_memory(const char *filename, uint32_t offset);
 
 	/**
-		Runs the CPU and triggers the interrupts if it is the case.
+		Runs the CPU up to the cycle count released by the pacer.
 	*/
 	void run();
 
 	/**
-		Runs an infinite loop with the game.
+		Runs frames back to back as fast as the host allows, printing the speed every second.
+	*/
+	void run_turbo();
+
+	/**
+		Runs the CPU and the scheduled events up to a cycle count. Everything happens at fixed
+		emulated cycles, so the result doesn't depend on how the host splits the run into calls.
+		@param target: cycle count to run to
+	*/
+	void run_until(uint64_t target);
+
+	/**
+		Runs the CPU for a number of cycles, handling the I/O instructions, and advances the cycle counter.
+		The counter is advanced after every core run, so the cores see the cycle count they start at.
+		@param budget: number of cycles to execute
+	*/
+	void execute(int32_t budget);
+
+	/**
+		Queues the interrupts of the current frame: RST 1 in the middle of the screen, RST 2 at vblank.
+	*/
+	void schedule_frame();
+
+	/**
+		Handles a due event.
+		@param type: the event (enum machine_event)
+	*/
+	void handle_event(uint32_t type);
+
+	/**
+		Takes the pending interrupt if interrupts are enabled. Otherwise it stays pending until EI.
+	*/
+	void deliver_interrupt();
+
+	/**
+		Switches to the instrumented core, which counts every opcode in state->stats. Slower than
+		the default core, but the emulation is the same.
+	*/
+	void count_opcodes();
+
+	/**
+		Switches to the instrumented core, which follows CALL, RET and the interrupts to build a
+		call graph in state->calls.
+	*/
+	void profile_calls();
+
+	/**
+		Switches to the instrumented core and records every instruction into a trace file, which
+		keeps the last records if the emulator dies.
+		@param path: trace file, NULL to keep the records in memory only
+		@param records: number of instructions to keep
+		@return 0 if the file couldn't be created
+	*/
+	uint8_t trace_to(const char *path, uint32_t records);
+
+	/**
+		Starts sampling PC into this->profile.
+		@param interval: emulated cycles between samples
+	*/
+	void profile_pc(uint32_t interval);
+
+	/**
+		Saves the machine state.
+		@param s: where to save it
+	*/
+	void save(SISnapshot *s);
+
+	/**
+		Puts the machine back in a saved state. The decoded blocks are dropped, as the code in
+		memory may differ.
+		@param s: the saved state, from this machine or one with the same ROM
+	*/
+	void restore(const SISnapshot *s);
+
+	/**
+		Runs the game until the display asks to quit.
 	*/
 	void start_emulation();
 
@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <algorithm>
+#include <vector>
+#include "emulator.h"
+#include "SIMachine.hpp"
+#include "Display.hpp"
+#include "video.h"
+#include "player.h"
+
+/*
+	Benchmarks with fixed workloads, printed as JSON on stdout:
+
+	- opcodes: emulate_8080_op on straight-line code made of one instruction class
+	- frames: the invaders ROM run headless with a scripted player
+	- video: video_update_surface on the screen left by the frames run, with the kernel picked for
+	  the host and then with every kernel the host supports, and video_update_bytes on all columns
+	- startup: creating a fresh SIMachine (allocations, JIT region, ROM files) and its first frame
+
+	Every workload runs several times and reports percentiles, so host noise shows up as spread
+	instead of moving the numbers. Runs from the emulator directory, the ROM path is relative.
+
+	Usage: benchmark [frames]
+*/
+
+#define RUNS 9						// samples per opcode class and for startup
+#define OPCODE_INSTRUCTIONS 2000000	// instructions per opcode class sample
+#define VIDEO_RUNS 200				// conversions measured
+
+/**
+	An instruction class: code made of copies of bytes, each copy counted as one sample of the class.
+*/
+typedef struct opcode_class{
+	const char *name;
+	uint8_t bytes[3];
+	uint8_t length;
+	uint8_t to_next;	// 1 if bytes[1..2] are replaced by the address of the next copy (jumps)
+} opcode_class;
+
+static const opcode_class classes[] = {
+	{ "mov_rr",		{ 0x78 },				1, 0 },	// MOV A,B
+	{ "mvi",		{ 0x06, 0x55 },			2, 0 },	// MVI B
+	{ "alu_reg",	{ 0x80 },				1, 0 },	// ADD B
+	{ "alu_imm",	{ 0xe6, 0x3c },			2, 0 },	// ANI
+	{ "inr_dcr",	{ 0x04, 0x0d },			2, 0 },	// INR B; DCR C
+	{ "pair",		{ 0x23, 0x09 },			2, 0 },	// INX H; DAD B
+	{ "mem_load",	{ 0x7e, 0x1a },			2, 0 },	// MOV A,M; LDAX D
+	{ "mem_store",	{ 0x77, 0x12 },			2, 0 },	// MOV M,A; STAX D
+	{ "rotate",		{ 0x07, 0x1f },			2, 0 },	// RLC; RAR
+	{ "push_pop",	{ 0xc5, 0xd1 },			2, 0 },	// PUSH B; POP D
+	{ "jmp",		{ 0xc3 },				3, 1 },	// JMP next
+	{ "jcc",		{ 0xc2 },				3, 1 },	// JNZ next
+	{ "call_ret",	{ 0xcd, 0x00, 0x30 },	3, 0 },	// CALL 3000, RET there
+};
+
+/**
+	@return the wall clock in nanoseconds
+*/
+static double now_ns(){
+	using namespace std::chrono;
+	return duration<double, std::nano>(steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+	Prints the percentiles of samples as a JSON object.
+	@param samples: the measurements, sorted in place
+*/
+static void print_percentiles(std::vector<double> &samples){
+	std::sort(samples.begin(), samples.end());
+	size_t n = samples.size();
+	printf("{ \"min\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f }",
+			samples[0], samples[n / 2], samples[n * 9 / 10], samples[n * 99 / 100], samples[n - 1]);
+}
+
+/**
+	Measures emulate_8080_op on code made of copies of one instruction class.
+	@param c: the instruction class
+	@param samples: filled with ns per instruction, one per run
+*/
+static void bench_opcodes(const opcode_class *c, std::vector<double> &samples){
+	state_8080 *state = (state_8080*)calloc(sizeof(state_8080), 1);
+	state->memory = (uint8_t*)calloc(0x10000, 1);
+
+	// code from 0000 to 1ff0, then a jump back to the start
+	uint16_t addr = 0;
+	while(addr + c->length < 0x1ff0){
+		memcpy(state->memory + addr, c->bytes, c->length);
+		if(c->to_next){
+			state->memory[addr + 1] = (addr + c->length) & 0xff;
+			state->memory[addr + 2] = (addr + c->length) >> 8;
+		}
+		addr += c->length;
+	}
+	state->memory[addr] = 0xc3;
+	state->memory[0x3000] = 0xc9;	// RET for call_ret
+
+	for(int run = 0; run < RUNS; run++){
+		state->pc = 0;
+		state->sp = 0x2400;		// stack and stores in RAM, the ROM is write protected
+		state->h = 0x24;
+		state->d = 0x28;
+		uint64_t first = state->instructions;
+		double start = now_ns();
+		while(state->instructions - first < OPCODE_INSTRUCTIONS){
+			emulate_8080_op(state);
+		}
+		samples.push_back((now_ns() - start) / (state->instructions - first));
+	}
+
+	free(state->memory);
+	free(state);
+}
+
+/**
+	Measures video_update_surface with the kernel in use.
+	@param vram: the screen to convert
+	@param samples: filled with us per conversion
+*/
+static void bench_video(const uint8_t *vram, std::vector<double> &samples){
+	alignas(VIDEO_ALIGN) static uint32_t pixels[VIDEO_WIDTH*VIDEO_HEIGHT];
+	for(int run = 0; run < VIDEO_RUNS; run++){
+		double start = now_ns();
+		video_update_surface(vram, pixels);
+		samples.push_back((now_ns() - start) / 1e3);
+	}
+}
+
+/**
+	Measures video_update_bytes on every column, the unrotated one byte per pixel image.
+	@param vram: the screen to convert
+	@param samples: filled with us per conversion
+*/
+static void bench_video_bytes(const uint8_t *vram, std::vector<double> &samples){
+	static uint8_t bytes[VIDEO_HEIGHT*VIDEO_WIDTH];
+	uint32_t dirty[VRAM_COLUMNS / 32];
+	video_span spans[VIDEO_MAX_SPANS];
+	memset(dirty, 0xff, sizeof(dirty));
+	for(int run = 0; run < VIDEO_RUNS; run++){
+		double start = now_ns();
+		video_update_bytes(vram, bytes, dirty, spans);
+		samples.push_back((now_ns() - start) / 1e3);
+	}
+}
+
+int main(int argc, char **argv){
+	uint64_t frames = argc > 1 ? strtoull(argv[1], NULL, 10) : 3600;
+
+	printf("{\n\t\"opcodes\": {\n");
+	for(uint32_t i = 0; i < sizeof(classes) / sizeof(classes[0]); i++){
+		std::vector<double> samples;
+		bench_opcodes(&classes[i], samples);
+		printf("\t\t\"%s\": { \"ns_per_instruction\": ", classes[i].name);
+		print_percentiles(samples);
+		printf(" }%s\n", i + 1 < sizeof(classes) / sizeof(classes[0]) ? "," : "");
+	}
+	printf("\t},\n");
+
+	// whole frames with the default core
+	{
+		NullDisplay display;
+		SIMachine machine(&display);
+		std::vector<double> samples;
+		double start = now_ns();
+		for(uint64_t f = 0; f < frames; f++){
+			machine.in_port1 = player_input(f);
+			double frame_start = now_ns();
+			machine.run_until((f + 1) * CPU_HZ / FRAME_HZ);
+			samples.push_back((now_ns() - frame_start) / 1e3);
+		}
+		double ns = now_ns() - start;
+
+		uint64_t hash = 0xcbf29ce484222325ULL;
+		for(uint32_t i = 0x2000; i < 0x4000; i++){
+			hash = (hash ^ machine.state->memory[i]) * 0x100000001b3ULL;
+		}
+		printf("\t\"frames\": { \"frames\": %llu, \"instructions\": %llu, \"ram_hash\": \"%016llx\", "
+				"\"frames_per_second\": %.1f, \"ns_per_instruction\": %.3f, \"dirty_columns_per_frame\": %.1f, \"frame_us\": ",
+				(unsigned long long)frames, (unsigned long long)machine.state->instructions,
+				(unsigned long long)hash, frames * 1e9 / ns, ns / machine.state->instructions,
+				(double)display.columns / display.frames);
+		print_percentiles(samples);
+		printf(" },\n");
+
+		// the screen of the last frame, with the kernel picked for the host, then with every kernel
+		uint8_t best = video_get_kernel();
+		std::vector<double> video;
+		bench_video(machine.get_framebuffer(), video);
+		printf("\t\"video\": { \"kernel\": \"%s\", \"frame_us\": ", video_kernel_name(best));
+		print_percentiles(video);
+		for(uint8_t kernel = VIDEO_SCALAR; kernel < VIDEO_KERNELS; kernel++){
+			if(video_set_kernel(kernel)){
+				video.clear();
+				bench_video(machine.get_framebuffer(), video);
+				printf(", \"%s_frame_us\": ", video_kernel_name(kernel));
+				print_percentiles(video);
+			}
+		}
+		video_set_kernel(best);
+		video.clear();
+		bench_video_bytes(machine.get_framebuffer(), video);
+		printf(", \"bytes_frame_us\": ");
+		print_percentiles(video);
+		printf(" },\n");
+	}
+
+	// fresh machines up to the end of their first frame
+	{
+		std::vector<double> samples;
+		for(int run = 0; run < RUNS; run++){
+			double start = now_ns();
+			NullDisplay display;
+			SIMachine *machine = new SIMachine(&display);
+			machine->run_until(CPU_HZ / FRAME_HZ);
+			delete machine;
+			samples.push_back((now_ns() - start) / 1e3);
+		}
+		printf("\t\"startup\": { \"first_us\": %.3f, \"us\": ", samples[0]);
+		print_percentiles(samples);
+		printf(" }\n");
+	}
+	printf("}\n");
+
+	return 0;
+}
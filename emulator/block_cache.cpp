@@ -0,0 +1,311 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "emulator.h"
+#include "block_cache.h"
+#include "fusion.h"
+
+/**
+	Allocates an empty block cache.
+	@return the block cache
+*/
+block_cache *block_cache_create(){
+	return (block_cache*)calloc(sizeof(block_cache), 1);
+}
+
+/**
+	Frees the block cache and all its blocks.
+	@param cache: the block cache
+*/
+void block_cache_destroy(block_cache *cache){
+	block_cache_flush(cache);
+	block_cache_free_retired(cache);
+	free(cache);
+}
+
+/**
+	Moves a block to the retired list. It can't be freed right away because the core may be running it.
+	@param cache: the block cache
+	@param b: the block
+*/
+static void retire(block_cache *cache, block *b){
+	cache->blocks[b->start] = NULL;
+	b->next = cache->retired;
+	cache->retired = b;
+}
+
+/**
+	Drops every decoded block (for example after loading new code into memory).
+	@param cache: the block cache
+*/
+void block_cache_flush(block_cache *cache){
+	for(uint32_t i = 0; i < 0x10000; i++){
+		if(cache->blocks[i] != NULL){
+			retire(cache, cache->blocks[i]);
+		}
+	}
+	memset(cache->code, 0, sizeof(cache->code));
+	cache->generation++;
+}
+
+/**
+	Drops the decoded blocks that contain addr. Called by write_ram.
+	@param cache: the block cache
+	@param addr: written address
+*/
+void block_cache_invalidate(block_cache *cache, uint16_t addr){
+	// only blocks starting at most BLOCK_MAX_BYTES before addr can cover it
+	for(uint32_t i = 0; i < BLOCK_MAX_BYTES; i++){
+		block *b = cache->blocks[(uint16_t)(addr - i)];
+		if(b != NULL && (uint16_t)(addr - b->start) < (uint16_t)(b->end - b->start)){
+			retire(cache, b);
+			cache->invalidations++;
+		}
+	}
+	// the bit stays set for bytes still covered by other blocks, clearing it is only an optimization
+	cache->code[addr >> 3] &= ~(1 << (addr & 7));
+	cache->generation++;
+}
+
+/**
+	Decodes the block starting at pc and stores it in the cache.
+	@param state: the CPU state
+	@param cache: the block cache
+	@param pc: start address
+	@return the new block
+*/
+static block *decode_block(state_8080 *state, block_cache *cache, uint16_t pc){
+	decoded_op ops[BLOCK_MAX_OPS];
+	uint16_t count = 0;
+	uint16_t instructions = 0;
+	uint8_t exit = 0;
+	int32_t cycles = 0;
+	int32_t last_cycles = 0;	// cycles of the last instruction
+	uint8_t last_opcode = 0;
+	uint16_t target = 0;		// operand of the last instruction, the target if it is a jump
+	uint8_t writes = 0;
+	uint16_t addr = pc;
+	uint16_t covered = pc;	// end of the bytes the block depends on
+
+	while(count < BLOCK_MAX_OPS){
+		uint8_t opcode = state->memory[addr];
+		if(opcode == 0xdb || opcode == 0xd3){
+			// IN/OUT are handled by the host. The block also depends on this opcode byte,
+			// otherwise an empty block could outlive the IN/OUT it stands for.
+			exit = 1;
+			covered = addr + 1;
+			break;
+		}
+
+		decoded_op *op = &ops[count++];
+		uint8_t fused = fusion_decode(state->memory, addr, op);
+		if(fused){
+			// continue after the last instruction of the sequence
+			decoded_op subs[3];
+			fusion_split(op, subs);
+			opcode = subs[fused - 1].bytes[0];
+			last_cycles = subs[fused - 1].cycles;
+			addr = subs[fused - 1].pc;
+		}
+		else{
+			op->handler = get_op_handler(opcode);
+			op->pc = addr;
+			op->bytes[0] = opcode;
+			op->bytes[1] = state->memory[(uint16_t)(addr + 1)];
+			op->bytes[2] = state->memory[(uint16_t)(addr + 2)];
+			op->bytes[3] = 0;
+			op->cycles = cycles8080[opcode];
+			op->writes = op_writes_memory(opcode);
+			op->count = 1;
+			last_cycles = op->cycles;
+		}
+		cycles += op->cycles;
+		instructions += op->count;
+		writes |= op->writes;
+		last_opcode = opcode;
+		target = (state->memory[(uint16_t)(addr + 2)] << 8) | state->memory[(uint16_t)(addr + 1)];
+		addr += lengths8080[opcode];
+		covered = addr;
+
+		if(opcode == 0xfb){
+			// EI, give the host a chance to take a pending interrupt
+			exit = 1;
+			break;
+		}
+		if(op_ends_block(opcode)){
+			break;
+		}
+	}
+
+	block *b = (block*)malloc(sizeof(block) + count * sizeof(decoded_op));
+	b->start = pc;
+	b->end = covered;
+	b->count = count;
+	b->instructions = instructions;
+	b->exit = exit;
+	b->cycles = cycles;
+	b->head_cycles = cycles - last_cycles;
+	b->next = NULL;
+	b->native = NULL;
+	b->native_failed = 0;
+	b->loop = !exit && !writes && target == pc &&
+			  (last_opcode == 0xc3 || last_opcode == 0xcb || (last_opcode & 0xc7) == 0xc2);	// JMP or Jcc to itself
+	b->ops = (decoded_op*)(b + 1);
+	memcpy(b->ops, ops, count * sizeof(decoded_op));
+
+	for(uint16_t i = pc; i != covered; i++){
+		cache->code[i >> 3] |= 1 << (i & 7);
+	}
+	cache->blocks[pc] = b;
+	return b;
+}
+
+/**
+	Returns the block starting at pc, decoding it on a miss.
+	@param state: the CPU state
+	@param pc: start address
+	@return the block
+*/
+block *block_cache_lookup(state_8080 *state, uint16_t pc){
+	block_cache *cache = state->cache;
+	block *b = cache->blocks[pc];
+	if(b == NULL){
+		cache->misses++;
+		return decode_block(state, cache, pc);
+	}
+	cache->hits++;
+	return b;
+}
+
+/**
+	Runs the instructions of a block, checking the budget like emulate_8080_run unless the whole
+	block fits in it. Stops early if the block overwrites decoded code.
+	@param state: the CPU state
+	@param b: the block, starting at state->pc
+	@param cycles: cycles executed so far, updated
+	@param budget: number of cycles to execute
+	@return 1 if the core has to return to the host
+*/
+uint8_t block_cache_run_block(state_8080 *state, block *b, int32_t *cycles, int32_t budget){
+	block_cache *cache = state->cache;
+	uint32_t generation = cache->generation;
+	decoded_op *op = b->ops;
+	decoded_op *end = b->ops + b->count;
+	int32_t done = *cycles;
+
+	if(done + b->head_cycles < budget){
+		// even the last instruction starts inside the budget, so run the whole block
+		for(; op != end; op++){
+			done += op->cycles;
+			state->instructions += op->count;
+			state->pc = op->pc + 1;
+			op->handler(state, op->bytes);
+			if(op->writes && cache->generation != generation){
+				// the block overwrote code, continue with a fresh lookup at the new PC
+				break;
+			}
+		}
+	}
+	else{
+		// check the budget before every instruction, like emulate_8080_run
+		for(; op != end; op++){
+			decoded_op subs[3];
+			fusion_split(op, subs);
+			for(uint8_t i = 0; i < op->count; i++){
+				// fused sequences run one instruction at a time here, the budget can end inside them
+				if(done >= budget){
+					*cycles = done;
+					return 1;
+				}
+				done += subs[i].cycles;
+				state->instructions++;
+				state->pc = subs[i].pc + 1;
+				subs[i].handler(state, subs[i].bytes);
+			}
+			if(op->writes && cache->generation != generation){
+				break;
+			}
+		}
+	}
+
+	*cycles = done;
+	return op == end && b->exit;
+}
+
+/**
+	@return 1 if the registers, flags and interrupt state of a and b are the same
+*/
+static uint8_t same_cpu_state(const state_8080 *a, const state_8080 *b){
+	return memcmp(a->regs, b->regs, sizeof(a->regs)) == 0 && a->sp == b->sp && a->pc == b->pc &&
+		   a->cc.psw == b->cc.psw && a->flags_kind == b->flags_kind && a->flags_a == b->flags_a &&
+		   a->flags_b == b->flags_b && a->flags_answer == b->flags_answer && a->int_enable == b->int_enable;
+}
+
+/**
+	Fast-forwards an idle loop. If the last run of a loop block left the CPU state unchanged, every
+	further iteration does the same until an interrupt changes memory, so the iterations that fit
+	in the budget are skipped and only charged. The partial iteration at the end of the budget
+	still runs normally.
+	@param state: the CPU state
+	@param b: the block that just ran, with b->loop set
+	@param before: copy of the CPU state before the block ran
+	@param cycles: cycles executed so far, updated
+	@param budget: number of cycles to execute
+*/
+void block_cache_skip_idle(state_8080 *state, block *b, const state_8080 *before, int32_t *cycles, int32_t budget){
+	if(!same_cpu_state(state, before)){
+		return;
+	}
+	// iterations that would run whole: each one starts its last instruction before the budget ends
+	int32_t left = budget - b->head_cycles - *cycles;
+	if(left > 0){
+		int32_t iterations = (left + b->cycles - 1) / b->cycles;
+		int32_t skipped = iterations * b->cycles;
+		*cycles += skipped;
+		state->instructions += (uint64_t)iterations * b->instructions;
+		state->cache->idle_skips++;
+		state->cache->idle_cycles += skipped;
+	}
+}
+
+/**
+	Frees the blocks waiting in the retired list. Only safe between blocks.
+	@param cache: the block cache
+*/
+void block_cache_free_retired(block_cache *cache){
+	while(cache->retired != NULL){
+		block *b = cache->retired;
+		cache->retired = b->next;
+		free(b);
+	}
+}
+
+/**
+	Same as emulate_8080_run, but runs pre-decoded blocks from state->cache and fast-forwards
+	idle loops to the end of the budget (block_cache_skip_idle).
+	@param state: the CPU state
+	@param budget: number of cycles to execute
+	@return the number of cycles executed
+*/
+int32_t emulate_8080_run_cached(state_8080 *state, int32_t budget){
+	int32_t cycles = 0;
+
+	block_cache_free_retired(state->cache);
+
+	while(cycles < budget){
+		block *b = block_cache_lookup(state, state->pc);
+		state_8080 before;
+		if(b->loop){
+			before = *state;
+		}
+		if(block_cache_run_block(state, b, &cycles, budget)){
+			break;
+		}
+		if(b->loop){
+			block_cache_skip_idle(state, b, &before, &cycles, budget);
+		}
+	}
+
+	return cycles;
+}
@@ -0,0 +1,177 @@
+#include <stdint.h>
+#include "emulator.h"
+
+#pragma once
+
+// longest straight-line run decoded into one block
+#define BLOCK_MAX_OPS 32
+
+// longest instruction sequence in one decoded_op (see fusion.h), it keeps decoded_op at 16 bytes
+#define FUSED_MAX_BYTES 4
+
+#define BLOCK_MAX_BYTES (BLOCK_MAX_OPS * FUSED_MAX_BYTES)
+
+/**
+	A pre-decoded instruction, or a fused sequence of instructions run by a single handler.
+*/
+typedef struct decoded_op{
+	op_handler handler;
+	uint16_t pc;		// address of the instruction
+	uint8_t bytes[FUSED_MAX_BYTES];	// opcode and operands
+	uint8_t cycles;
+	uint8_t writes : 1;	// 1 if the instruction can write memory (and so invalidate code)
+	uint8_t count : 7;	// number of instructions, more than 1 for a fused sequence
+} decoded_op;
+
+/**
+	A straight-line run of instructions starting at a given PC. It ends with the first control
+	transfer, before IN/OUT, after EI, or after BLOCK_MAX_OPS instructions.
+*/
+typedef struct block{
+	uint16_t start;
+	uint16_t end;			// address after the last byte the block was decoded from
+	uint16_t count;			// number of instructions
+	uint16_t instructions;	// number of 8080 instructions, the ones in fused sequences counted one by one
+	uint8_t exit;			// 1 if the core must return to the host after the block (IN/OUT next, or EI)
+	int32_t cycles;			// cycles of all instructions
+	int32_t head_cycles;	// cycles of all instructions but the last one
+	struct block *next;		// link in the retired list
+	void *native;			// compiled code (see jit.h), NULL if not compiled
+	uint8_t native_failed;	// 1 if the JIT gave up on this block
+	uint8_t loop;			// 1 if the block jumps back to its start and writes no memory (idle loop candidate)
+	decoded_op *ops;
+} block;
+
+/**
+	Block cache, keyed by PC.
+*/
+typedef struct block_cache{
+	uint8_t code[0x10000 / 8];	// bitmap of the bytes covered by a decoded block
+	block *blocks[0x10000];
+	block *retired;				// invalidated blocks, freed on the next run
+	uint32_t generation;		// incremented on every invalidation
+
+	// statistics
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t invalidations;
+	uint64_t idle_skips;	// idle loops fast-forwarded
+	uint64_t idle_cycles;	// cycles skipped in idle loops
+} block_cache;
+
+/**
+	@param opcode: instruction opcode
+	@return 1 if the instruction can change the control flow, so it has to end a block
+*/
+static inline constexpr uint8_t op_ends_block(uint8_t opcode){
+	switch(opcode){
+		case 0xc3: case 0xcb: case 0xe9:	// JMP, PCHL
+		case 0xcd: case 0xc9:				// CALL, RET
+		case 0x76:							// HLT
+			return 1;
+	}
+	// Jcc, Ccc, Rcc and RST
+	return (opcode & 0xc0) == 0xc0 && ((opcode & 7) == 0 || (opcode & 7) == 2 || (opcode & 7) == 4 || (opcode & 7) == 7);
+}
+
+/**
+	@param opcode: instruction opcode
+	@return 1 if the instruction can write memory
+*/
+static inline constexpr uint8_t op_writes_memory(uint8_t opcode){
+	switch(opcode){
+		case 0x02: case 0x12: case 0x22: case 0x32:	// STAX B, STAX D, SHLD, STA
+		case 0x34: case 0x35: case 0x36:			// INR M, DCR M, MVI M
+		case 0xc5: case 0xd5: case 0xe5: case 0xf5:	// PUSH
+		case 0xe3: case 0xcd:						// XTHL, CALL
+			return 1;
+	}
+	if((opcode & 0xf8) == 0x70 && opcode != 0x76){
+		// MOV M, r
+		return 1;
+	}
+	// Ccc and RST push the return address
+	return (opcode & 0xc0) == 0xc0 && ((opcode & 7) == 4 || (opcode & 7) == 7);
+}
+
+
+/**
+	Allocates an empty block cache.
+	@return the block cache
+*/
+block_cache *block_cache_create();
+
+/**
+	Frees the block cache and all its blocks.
+	@param cache: the block cache
+*/
+void block_cache_destroy(block_cache *cache);
+
+/**
+	Drops every decoded block (for example after loading new code into memory).
+	@param cache: the block cache
+*/
+void block_cache_flush(block_cache *cache);
+
+/**
+	@param cache: the block cache
+	@param addr: memory address
+	@return nonzero if the byte at addr belongs to a decoded block
+*/
+static inline uint8_t block_cache_is_code(block_cache *cache, uint16_t addr){
+	return cache->code[addr >> 3] & (1 << (addr & 7));
+}
+
+/**
+	Drops the decoded blocks that contain addr. Called by write_ram.
+	@param cache: the block cache
+	@param addr: written address
+*/
+void block_cache_invalidate(block_cache *cache, uint16_t addr);
+
+/**
+	Returns the block starting at pc, decoding it on a miss.
+	@param state: the CPU state
+	@param pc: start address
+	@return the block
+*/
+block *block_cache_lookup(state_8080 *state, uint16_t pc);
+
+/**
+	Runs the instructions of a block, checking the budget like emulate_8080_run unless the whole
+	block fits in it. Stops early if the block overwrites decoded code.
+	@param state: the CPU state
+	@param b: the block, starting at state->pc
+	@param cycles: cycles executed so far, updated
+	@param budget: number of cycles to execute
+	@return 1 if the core has to return to the host
+*/
+uint8_t block_cache_run_block(state_8080 *state, block *b, int32_t *cycles, int32_t budget);
+
+/**
+	Fast-forwards an idle loop. If the last run of a loop block left the CPU state unchanged, every
+	further iteration does the same until an interrupt changes memory, so the iterations that fit
+	in the budget are skipped and only charged. The partial iteration at the end of the budget
+	still runs normally.
+	@param state: the CPU state
+	@param b: the block that just ran, with b->loop set
+	@param before: copy of the CPU state before the block ran
+	@param cycles: cycles executed so far, updated
+	@param budget: number of cycles to execute
+*/
+void block_cache_skip_idle(state_8080 *state, block *b, const state_8080 *before, int32_t *cycles, int32_t budget);
+
+/**
+	Frees the blocks waiting in the retired list. Only safe between blocks.
+	@param cache: the block cache
+*/
+void block_cache_free_retired(block_cache *cache);
+
+/**
+	Same as emulate_8080_run, but runs pre-decoded blocks from state->cache and fast-forwards
+	idle loops to the end of the budget (block_cache_skip_idle).
+	@param state: the CPU state
+	@param budget: number of cycles to execute
+	@return the number of cycles executed
+*/
+int32_t emulate_8080_run_cached(state_8080 *state, int32_t budget);
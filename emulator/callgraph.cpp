@@ -0,0 +1,258 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include "callgraph.h"
+#include "symbols.h"
+#include "report.h"
+
+/**
+	Totals of a subroutine over all its call chains.
+*/
+typedef struct routine_total{
+	uint16_t addr;
+	uint8_t interrupt;
+	uint64_t calls;
+	uint64_t inclusive;
+	uint64_t exclusive;
+} routine_total;
+
+/**
+	@return a new empty call graph
+*/
+callgraph *callgraph_create(){
+	callgraph *cg = new callgraph();
+	cg->root.addr = 0;
+	cg->root.interrupt = 0;
+	cg->root.parent = NULL;
+	cg->root.calls = 0;
+	cg->root.cycles = 0;
+	cg->current = &cg->root;
+	return cg;
+}
+
+/**
+	Frees a node and everything below it.
+	@param node: the node
+*/
+static void free_children(call_node *node){
+	for(call_node *child : node->children){
+		free_children(child);
+		delete child;
+	}
+}
+
+/**
+	@param cg: the call graph
+*/
+void callgraph_destroy(callgraph *cg){
+	free_children(&cg->root);
+	delete cg;
+}
+
+/**
+	Drops the frames whose SP is at or below sp, the stack was unwound past them.
+	@param cg: the call graph
+	@param sp: stack pointer
+*/
+static void drop_frames_below(callgraph *cg, uint16_t sp){
+	while(!cg->frames.empty() && cg->frames.back().sp <= sp){
+		cg->frames.pop_back();
+	}
+	cg->current = cg->frames.empty() ? &cg->root : cg->frames.back().node;
+}
+
+/**
+	Enters a subroutine, after a taken CALL or RST or an interrupt.
+	@param cg: the call graph
+	@param addr: subroutine entry, the new PC
+	@param sp: SP after the return address was pushed
+	@param interrupt: 1 for interrupts
+*/
+void callgraph_call(callgraph *cg, uint16_t addr, uint16_t sp, uint8_t interrupt){
+	// a new frame at or above an open one means that one was abandoned (SPHL, POP of the return address)
+	drop_frames_below(cg, sp);
+
+	call_node *node = NULL;
+	for(call_node *child : cg->current->children){
+		if(child->addr == addr && child->interrupt == interrupt){
+			node = child;
+			break;
+		}
+	}
+	if(node == NULL){
+		node = new call_node();
+		node->addr = addr;
+		node->interrupt = interrupt;
+		node->parent = cg->current;
+		node->calls = 0;
+		node->cycles = 0;
+		cg->current->children.push_back(node);
+	}
+
+	node->calls++;
+	cg->frames.push_back({ node, sp });
+	cg->current = node;
+}
+
+/**
+	Leaves subroutines after a taken RET.
+	@param cg: the call graph
+	@param sp: SP the return address was popped from
+*/
+void callgraph_return(callgraph *cg, uint16_t sp){
+	// frames below sp were left without their RET
+	while(!cg->frames.empty() && cg->frames.back().sp < sp){
+		cg->frames.pop_back();
+	}
+	if(!cg->frames.empty() && cg->frames.back().sp == sp){
+		cg->frames.pop_back();
+	}
+	// otherwise the RET popped something the ROM pushed itself, a jump
+	cg->current = cg->frames.empty() ? &cg->root : cg->frames.back().node;
+}
+
+/**
+	@param map: labels of the subroutines
+	@param addr: subroutine entry
+	@param interrupt: 1 if entered by an interrupt
+	@return the name of the subroutine, interrupt handlers marked with [int]
+*/
+static std::string routine_name(const symbol_map *map, uint16_t addr, uint8_t interrupt){
+	std::string name = symbol_map_name(map, addr);
+	return interrupt ? name + "[int]" : name;
+}
+
+/**
+	@param map: labels of the subroutines
+	@param node: call tree node
+	@return the name of the subroutine of the node
+*/
+static std::string node_name(const symbol_map *map, const call_node *node){
+	if(node->parent == NULL){
+		return "root";
+	}
+	return routine_name(map, node->addr, node->interrupt);
+}
+
+/**
+	Adds up the cycles of a node and the nodes below it into the subroutine totals.
+	@param node: the node
+	@param totals: totals by subroutine, key is the address and the interrupt flag
+	@param open: subroutines on the path to node, so recursion is counted once in inclusive cycles
+	@return the inclusive cycles of node
+*/
+static uint64_t add_totals(const call_node *node, std::map<uint32_t, routine_total> &totals, std::map<uint32_t, int> &open){
+	uint32_t key = (node->interrupt << 16) | node->addr;
+	uint64_t inclusive = node->cycles;
+
+	open[key]++;
+	for(const call_node *child : node->children){
+		inclusive += add_totals(child, totals, open);
+	}
+	open[key]--;
+
+	routine_total &t = totals[key];
+	t.addr = node->addr;
+	t.interrupt = node->interrupt;
+	t.calls += node->calls;
+	t.exclusive += node->cycles;
+	if(open[key] == 0){
+		t.inclusive += inclusive;
+	}
+	return inclusive;
+}
+
+/**
+	Prints the subroutines ranked by inclusive cycles, with exclusive cycles and calls.
+	@param cg: the call graph
+	@param map: labels of the subroutines
+	@param out: where to print
+	@param top: number of subroutines to list
+*/
+void callgraph_report(const callgraph *cg, const symbol_map *map, FILE *out, uint32_t top){
+	std::map<uint32_t, routine_total> totals;
+	std::map<uint32_t, int> open;
+	uint64_t total = 0;
+
+	// the root is not a subroutine
+	for(const call_node *child : cg->root.children){
+		total += add_totals(child, totals, open);
+	}
+	total += cg->root.cycles;
+	if(total == 0){
+		fprintf(out, "no cycles counted\n");
+		return;
+	}
+
+	std::vector<routine_total> ranked;
+	for(auto &t : totals){
+		ranked.push_back(t.second);
+	}
+	std::sort(ranked.begin(), ranked.end(), [](const routine_total &a, const routine_total &b){
+		return a.inclusive > b.inclusive;
+	});
+
+	fprintf(out, "%llu cycles, %llu outside any call\n\n", (unsigned long long)total, (unsigned long long)cg->root.cycles);
+	fprintf(out, "       inclusive        %%        exclusive        %%       calls  subroutine\n");
+	for(uint32_t i = 0; i < top && i < ranked.size(); i++){
+		routine_total *t = &ranked[i];
+		fprintf(out, "%16llu  %6.2f%%  %15llu  %6.2f%%  %10llu  %s\n", (unsigned long long)t->inclusive,
+				100.0 * t->inclusive / total, (unsigned long long)t->exclusive, 100.0 * t->exclusive / total,
+				(unsigned long long)t->calls, routine_name(map, t->addr, t->interrupt).c_str());
+	}
+}
+
+/**
+	Writes the folded stacks of a node and the nodes below it.
+	@param node: the node
+	@param map: labels of the subroutines
+	@param path: folded names of the callers
+	@param out: where to write
+*/
+static void write_folded(const call_node *node, const symbol_map *map, const std::string &path, FILE *out){
+	std::string stack = path.empty() ? node_name(map, node) : path + ";" + node_name(map, node);
+	if(node->cycles){
+		fprintf(out, "%s %llu\n", stack.c_str(), (unsigned long long)node->cycles);
+	}
+	for(const call_node *child : node->children){
+		write_folded(child, map, stack, out);
+	}
+}
+
+/**
+	Writes the exclusive cycles of every call chain as folded stacks ("caller;callee cycles" lines).
+	@param cg: the call graph
+	@param map: labels of the subroutines
+	@param out: where to write
+*/
+void callgraph_folded(const callgraph *cg, const symbol_map *map, FILE *out){
+	write_folded(&cg->root, map, "", out);
+}
+
+/**
+	report_dump callback for the report.
+*/
+static void report(const void *data, const symbol_map *map, FILE *out){
+	callgraph_report((const callgraph*)data, map, out, REPORT_TOP);
+}
+
+/**
+	report_dump callback for the folded stacks.
+*/
+static void folded(const void *data, const symbol_map *map, FILE *out){
+	callgraph_folded((const callgraph*)data, map, out);
+}
+
+/**
+	Prints the cycles per routine on stdout and writes the cycles per call stack to a file.
+	@param cg: the call graph
+	@param symbols_path: symbol file, NULL for none
+	@param folded_path: folded stacks file
+*/
+void callgraph_dump(const callgraph *cg, const char *symbols_path, const char *folded_path){
+	report_dump(cg, report, folded, symbols_path, folded_path);
+}
@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+#include "symbols.h"
+
+#pragma once
+
+/**
+	@param opcode: instruction opcode
+	@return 1 for CALL, Ccc and RST
+*/
+static inline constexpr uint8_t op_is_call(uint8_t opcode){
+	return opcode == 0xcd || (opcode & 0xc7) == 0xc4 || (opcode & 0xc7) == 0xc7;
+}
+
+/**
+	@param opcode: instruction opcode
+	@return 1 for RET and Rcc
+*/
+static inline constexpr uint8_t op_is_return(uint8_t opcode){
+	return opcode == 0xc9 || (opcode & 0xc7) == 0xc0;
+}
+
+/**
+	A node of the call tree: a subroutine reached through a given chain of callers.
+*/
+typedef struct call_node{
+	uint16_t addr;			// subroutine entry
+	uint8_t interrupt;		// 1 if entered by an interrupt
+	struct call_node *parent;
+	std::vector<struct call_node*> children;
+	uint64_t calls;			// times it was entered
+	uint64_t cycles;		// exclusive cycles
+} call_node;
+
+/**
+	A subroutine on the shadow stack.
+*/
+typedef struct call_frame{
+	call_node *node;
+	uint16_t sp;	// SP right after the return address was pushed
+} call_frame;
+
+/**
+	Call graph profile, kept by the instrumented core (emulate_8080_run_stats) with a shadow stack
+	of the CALL, RST and RET instructions and the interrupts.
+
+	The frames are matched by SP, not by return address, so the ROM can rewrite return addresses
+	(XTHL), drop frames (POP, SPHL) or jump with PUSH+RET: a RET only closes the frame whose SP it
+	pops, frames below the SP of a CALL or RET were abandoned and are closed with it, and a RET that
+	pops no frame's address is a jump.
+*/
+typedef struct callgraph{
+	call_node root;						// code outside any call
+	call_node *current;
+	std::vector<call_frame> frames;		// shadow stack, innermost last
+} callgraph;
+
+/**
+	@return a new empty call graph
+*/
+callgraph *callgraph_create();
+
+/**
+	@param cg: the call graph
+*/
+void callgraph_destroy(callgraph *cg);
+
+/**
+	Charges cycles to the current subroutine.
+	@param cg: the call graph
+	@param cycles: cycles executed
+*/
+static inline void callgraph_cycles(callgraph *cg, uint32_t cycles){
+	cg->current->cycles += cycles;
+}
+
+/**
+	Enters a subroutine, after a taken CALL or RST or an interrupt.
+	@param cg: the call graph
+	@param addr: subroutine entry, the new PC
+	@param sp: SP after the return address was pushed
+	@param interrupt: 1 for interrupts
+*/
+void callgraph_call(callgraph *cg, uint16_t addr, uint16_t sp, uint8_t interrupt);
+
+/**
+	Leaves subroutines after a taken RET.
+	@param cg: the call graph
+	@param sp: SP the return address was popped from
+*/
+void callgraph_return(callgraph *cg, uint16_t sp);
+
+/**
+	Prints the subroutines ranked by inclusive cycles, with exclusive cycles and calls.
+	@param cg: the call graph
+	@param map: labels of the subroutines
+	@param out: where to print
+	@param top: number of subroutines to list
+*/
+void callgraph_report(const callgraph *cg, const symbol_map *map, FILE *out, uint32_t top);
+
+/**
+	Writes the exclusive cycles of every call chain as folded stacks ("caller;callee cycles" lines).
+	@param cg: the call graph
+	@param map: labels of the subroutines
+	@param out: where to write
+*/
+void callgraph_folded(const callgraph *cg, const symbol_map *map, FILE *out);
+
+/**
+	Prints the cycles per routine on stdout and writes the cycles per call stack to a file.
+	@param cg: the call graph
+	@param symbols_path: symbol file, NULL for none
+	@param folded_path: folded stacks file
+*/
+void callgraph_dump(const callgraph *cg, const char *symbols_path, const char *folded_path);
@@ -0,0 +1,28 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "emulator.h"
+#include "CPMMachine.hpp"
+
+/*
+	Runs a CP/M .COM program until it warm boots. The BDOS file calls use the current directory.
+
+	Usage: cpm <program.com> [arguments...]
+*/
+
+int main(int argc, char **argv){
+	if(argc < 2){
+		printf("Usage: %s <program.com> [arguments...]\n", argv[0]);
+		return 1;
+	}
+
+	CPMMachine machine(".");
+	if(!machine.load(argv[1], argc - 2, argv + 2)){
+		printf("ERROR: couldn't open %s\n", argv[1]);
+		return 1;
+	}
+	machine.run();
+	fflush(stdout);
+
+	return 0;
+}
@@ -0,0 +1,310 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <array>
+#include <utility>
+#include "emulator.h"
+#include "block_cache.h"
+#include "emulator_ops.h"
+#include "opcode_stats.h"
+#include "callgraph.h"
+#include "trace.h"
+
+uint8_t cycles8080[] = {
+	4, 10, 7, 5, 5, 5, 7, 4, 4, 10, 7, 5, 5, 5, 7, 4, //0x00..0x0f
+	4, 10, 7, 5, 5, 5, 7, 4, 4, 10, 7, 5, 5, 5, 7, 4, //0x10..0x1f
+	4, 10, 16, 5, 5, 5, 7, 4, 4, 10, 16, 5, 5, 5, 7, 4, //etc
+	4, 10, 13, 5, 10, 10, 10, 4, 4, 10, 13, 5, 5, 5, 7, 4,
+	
+	5, 5, 5, 5, 5, 5, 7, 5, 5, 5, 5, 5, 5, 5, 7, 5, //0x40..0x4f
+	5, 5, 5, 5, 5, 5, 7, 5, 5, 5, 5, 5, 5, 5, 7, 5,
+	5, 5, 5, 5, 5, 5, 7, 5, 5, 5, 5, 5, 5, 5, 7, 5,
+	7, 7, 7, 7, 7, 7, 7, 7, 5, 5, 5, 5, 5, 5, 7, 5,
+	
+	4, 4, 4, 4, 4, 4, 7, 4, 4, 4, 4, 4, 4, 4, 7, 4, //0x80..8x4f
+	4, 4, 4, 4, 4, 4, 7, 4, 4, 4, 4, 4, 4, 4, 7, 4,
+	4, 4, 4, 4, 4, 4, 7, 4, 4, 4, 4, 4, 4, 4, 7, 4,
+	4, 4, 4, 4, 4, 4, 7, 4, 4, 4, 4, 4, 4, 4, 7, 4,
+	
+	11, 10, 10, 10, 17, 11, 7, 11, 11, 10, 10, 10, 10, 17, 7, 11, //0xc0..0xcf
+	11, 10, 10, 10, 17, 11, 7, 11, 11, 10, 10, 10, 10, 17, 7, 11, 
+	11, 10, 10, 18, 17, 11, 7, 11, 11, 5, 10, 5, 17, 17, 7, 11, 
+	11, 10, 10, 4, 17, 11, 7, 11, 11, 5, 10, 4, 17, 17, 7, 11, 
+};
+
+// length in bytes of every instruction
+uint8_t lengths8080[] = {
+	1, 3, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1, //0x00..0x0f
+	1, 3, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1, //0x10..0x1f
+	1, 3, 3, 1, 1, 1, 2, 1, 1, 1, 3, 1, 1, 1, 2, 1, //0x20..0x2f
+	1, 3, 3, 1, 1, 1, 2, 1, 1, 1, 3, 1, 1, 1, 2, 1, //0x30..0x3f
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, //0x40..0x4f
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, //0x50..0x5f
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, //0x60..0x6f
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, //0x70..0x7f
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, //0x80..0x8f
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, //0x90..0x9f
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, //0xa0..0xaf
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, //0xb0..0xbf
+	1, 1, 3, 3, 3, 1, 2, 1, 1, 1, 3, 3, 3, 3, 2, 1, //0xc0..0xcf
+	1, 1, 3, 2, 3, 1, 2, 1, 1, 1, 3, 2, 3, 1, 2, 1, //0xd0..0xdf
+	1, 1, 3, 1, 3, 1, 2, 1, 1, 1, 3, 1, 3, 1, 2, 1, //0xe0..0xef
+	1, 1, 3, 1, 3, 1, 2, 1, 1, 1, 3, 1, 3, 1, 2, 1, //0xf0..0xff
+};
+
+/**
+	Computes the PSW from the pending flag-setting operation, if any.
+	@param state: the CPU state
+*/
+void materialize_flags(state_8080 *state){
+	if(state->flags_kind != FLAGS_NONE){
+		state->cc.psw = compute_flags(state->flags_kind, state->flags_a, state->flags_b, state->flags_answer, state->cc.psw);
+		state->flags_kind = FLAGS_NONE;
+	}
+}
+
+// For debugging
+uint32_t disassemble8080op(uint8_t *buffer, uint32_t pc);
+
+/**
+	Prints an error message and exits the program when the emulator hits an unimplemented instruction.
+	@param state: the CPU state
+*/
+void unimplemented_instruction(state_8080 *state){
+	printf("ERROR: Unimplemented instruction: %02x\n PC: %04x\n", state->memory[state->pc - 1], state->pc - 1);
+	if(state->trace != NULL){
+		printf("the trace file holds the instructions before it (tracedump -last 50)\n");
+	}
+	exit(1);
+}
+
+/**
+	Wraps the memory writing operation so it blocks attempted writes to the ROM, unless the
+	memory is flat, and marks the VRAM columns written.
+	@param state: the CPU state
+	@param addr: RAM address
+	@param val: value to write
+*/
+void write_ram(state_8080 *state, uint16_t addr, uint8_t val){
+	if(!state->flat_memory && (addr < 0x2000 || addr >= 0x4000)){
+		return;
+	}
+	state->memory[addr] = val;
+
+	// the display converts only the columns written since the last frame
+	if((uint16_t)(addr - VRAM_START) < VRAM_END - VRAM_START){
+		uint32_t column = (addr - VRAM_START) / VRAM_COLUMN_BYTES;
+		state->vram_dirty[column / 32] |= 1u << (column % 32);
+	}
+
+	// self-modifying code: drop the decoded blocks that contain addr
+	if(state->cache != NULL && block_cache_is_code(state->cache, addr)){
+		block_cache_invalidate(state->cache, addr);
+	}
+}
+
+/**
+	Push a value to the stack.
+	@param state: the CPU state
+	@param high: the MSB
+	@param low: the LSB
+*/
+void push(state_8080 *state, uint8_t high, uint8_t low){
+	write_ram(state, state->sp-1, high);
+	write_ram(state, state->sp-2, low);
+	state->sp -=  2;
+}
+
+/**
+	Pops a value from the stack
+	@param state: the CPU state
+	@param high: the MSB destination
+	@param low: the LSB destination
+*/
+void pop(state_8080 *state, uint8_t *high, uint8_t *low){
+	*low = state->memory[state->sp];
+	*high = state->memory[state->sp + 1];
+	state->sp += 2;
+}
+
+// X-macro over all 256 opcodes (as two hex digits), used to build the label table of the threaded core
+#define OPCODE_ROW(X, h) X(h##0) X(h##1) X(h##2) X(h##3) X(h##4) X(h##5) X(h##6) X(h##7) \
+						 X(h##8) X(h##9) X(h##A) X(h##B) X(h##C) X(h##D) X(h##E) X(h##F)
+#define OPCODE_LIST(X) OPCODE_ROW(X, 0) OPCODE_ROW(X, 1) OPCODE_ROW(X, 2) OPCODE_ROW(X, 3) \
+					   OPCODE_ROW(X, 4) OPCODE_ROW(X, 5) OPCODE_ROW(X, 6) OPCODE_ROW(X, 7) \
+					   OPCODE_ROW(X, 8) OPCODE_ROW(X, 9) OPCODE_ROW(X, A) OPCODE_ROW(X, B) \
+					   OPCODE_ROW(X, C) OPCODE_ROW(X, D) OPCODE_ROW(X, E) OPCODE_ROW(X, F)
+
+/**
+	Builds the dispatch table from the op<> handlers at compile time.
+*/
+template<size_t... I> static constexpr std::array<op_handler, 256> make_op_table(std::index_sequence<I...>){
+	return {{ &op<I>... }};
+}
+
+static constexpr std::array<op_handler, 256> op_table = make_op_table(std::make_index_sequence<256>());
+
+/**
+	@param opcode: instruction opcode
+	@return the handler that executes the opcode
+*/
+op_handler get_op_handler(uint8_t opcode){
+	return op_table[opcode];
+}
+
+/**
+	Executes an Intel 8080 instruction
+	@param state: the CPU state
+	@return the number of cycles the instruction takes
+*/
+uint8_t emulate_8080_op(state_8080 *state){
+	uint8_t *opcode = state->memory + state->pc;
+	uint8_t op = *opcode;	// the instruction may overwrite itself, its cycles are the ones it started with
+
+	if(state->trace != NULL){
+		materialize_flags(state);
+		trace_add(state->trace, state, state->pc, state->cycles);
+	}
+
+	state->pc += 1;
+	state->instructions++;
+	op_table[op](state, opcode);
+
+	return cycles8080[op];
+}
+
+
+/**
+	Runs an instruction like op<OP>, and records it into whichever of state->trace, state->stats
+	and state->calls is set.
+	@param state: the CPU state
+	@param opcode: the instruction bytes
+	@param cycle: cycle count when the instruction started
+*/
+template<uint8_t OP> static inline void op_instrumented(state_8080 *state, uint8_t *opcode, uint64_t cycle){
+	if(state->trace != NULL){
+		materialize_flags(state);
+		trace_add(state->trace, state, state->pc - 1, cycle);
+	}
+	if(state->stats != NULL){
+		opcode_stats_count(state->stats, OP, cycles8080[OP]);
+	}
+	if(state->calls == NULL){
+		op<OP>(state, opcode);
+		return;
+	}
+
+	// taken calls and returns are the ones that move SP
+	uint16_t sp = state->sp;
+	callgraph_cycles(state->calls, cycles8080[OP]);
+	op<OP>(state, opcode);
+	if constexpr(op_is_call(OP)){
+		if(state->sp != sp){
+			callgraph_call(state->calls, state->pc, state->sp, 0);
+		}
+	}
+	else if constexpr(op_is_return(OP)){
+		if(state->sp != sp){
+			callgraph_return(state->calls, sp);
+		}
+	}
+}
+
+/**
+	Threaded core behind emulate_8080_run and emulate_8080_run_stats.
+	@param state: the CPU state
+	@param budget: number of cycles to execute
+	@return the number of cycles executed
+*/
+template<bool INSTRUMENTED> static inline int32_t run_threaded(state_8080 *state, int32_t budget){
+	// IN and OUT are handled by the machine, so they leave the core with PC still on them. Set in
+	// the initializer, the table is never written and cores on several threads can share it
+#define LABEL(n) (0x##n == 0xdb || 0x##n == 0xd3) ? &&io_exit : 0x##n == 0xfb ? &&ei_exit : &&op_label_##n,
+	static void *const labels[256] = { OPCODE_LIST(LABEL) };
+#undef LABEL
+	int32_t cycles = 0;
+	uint8_t *opcode;
+
+	// direct-threaded dispatch: every handler ends with its own jump through the label table
+
+#define DISPATCH() \
+	if(cycles >= budget){ \
+		return cycles; \
+	} \
+	opcode = state->memory + state->pc; \
+	cycles += cycles8080[*opcode]; \
+	state->pc += 1; \
+	state->instructions++; \
+	goto *labels[*opcode]
+
+// counted in the handlers, so the IN/OUT left to the machine are not
+#define RUN(n) \
+	if constexpr(INSTRUMENTED){ \
+		op_instrumented<n>(state, opcode, state->cycles + cycles - cycles8080[n]); \
+	} \
+	else{ \
+		op<n>(state, opcode); \
+	}
+
+	DISPATCH();
+
+#define TARGET(n) op_label_##n: RUN(0x##n); DISPATCH();
+	OPCODE_LIST(TARGET)
+#undef TARGET
+
+io_exit:
+	state->pc -= 1;
+	state->instructions--;
+	return cycles - cycles8080[*opcode];
+
+ei_exit:
+	RUN(0xfb);
+	return cycles;
+#undef RUN
+#undef DISPATCH
+}
+
+/**
+	Executes instructions until the cycle budget is used up or the next instruction needs the host.
+	Returns early with PC on an IN or OUT instruction, and after EI so a pending interrupt can be taken.
+	@param state: the CPU state
+	@param budget: number of cycles to execute
+	@return the number of cycles executed
+*/
+int32_t emulate_8080_run(state_8080 *state, int32_t budget){
+	return run_threaded<false>(state, budget);
+}
+
+/**
+	Same as emulate_8080_run, but also records every instruction into whichever of state->trace
+	(instruction trace, trace.h), state->stats (opcode counters, opcode_stats.h) and state->calls
+	(call graph, callgraph.h) is set. A separate build of the same core, so emulate_8080_run
+	doesn't pay for the counters.
+	@param state: the CPU state, with trace, stats or calls set
+	@param budget: number of cycles to execute
+	@return the number of cycles executed
+*/
+int32_t emulate_8080_run_stats(state_8080 *state, int32_t budget){
+	return run_threaded<true>(state, budget);
+}
+
+
+void generate_interrupt(state_8080 *state, uint32_t interrupt_number){
+	// push PC
+	push(state, (state->pc & 0xFF00) >> 8, (state->pc & 0xFF));
+
+	// set PC to low memory function
+	// equivalent to RST
+	state->pc = 8 * interrupt_number;
+
+	state->int_enable = 0;
+
+	if(state->stats != NULL){
+		state->stats->interrupts[interrupt_number & 7]++;
+		state->stats->last = 0x100;	// the handler doesn't follow the interrupted instruction
+	}
+	if(state->calls != NULL){
+		callgraph_call(state->calls, state->pc, state->sp, 1);
+	}
+}
+
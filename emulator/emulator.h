@@ -2,33 +2,98 @@
 
 #pragma once
 
-struct condition_codes{
-	uint8_t z:1;	// zero (1 if result == 0)
-	uint8_t s:1;	// sign (1 if 7th bit is set)
-	uint8_t p:1;	// parity (1 when result is even)
-	uint8_t cy:1;	// carry (1 when result carried)
-	uint8_t ac:1;	// auxillary carry - not implemented
-	uint8_t pad:3;
+// flag bits in the PSW byte (S Z 0 AC 0 P 1 CY)
+#define FLAG_CY 0x01
+#define FLAG_P 0x04
+#define FLAG_AC 0x10
+#define FLAG_Z 0x40
+#define FLAG_S 0x80
+
+// video RAM of the arcade memory map, 32 bytes per column of the upright screen
+#define VRAM_START 0x2400
+#define VRAM_END 0x4000
+#define VRAM_COLUMN_BYTES 32
+#define VRAM_COLUMNS ((VRAM_END - VRAM_START) / VRAM_COLUMN_BYTES)
+
+// operation whose flags are still pending (only used when built with LAZY_FLAGS)
+enum flags_kind{ FLAGS_NONE, FLAGS_ADD, FLAGS_SUB, FLAGS_ANA, FLAGS_LOGIC, FLAGS_INR, FLAGS_DCR };
+
+/**
+	Condition codes. The bit fields follow the 8080 PSW layout, so psw can be pushed/popped
+	and written by the flag tables in a single store.
+*/
+union condition_codes{
+	struct{
+		uint8_t cy:1;	// carry (1 when result carried)
+		uint8_t pad1:1;
+		uint8_t p:1;	// parity (1 when result is even)
+		uint8_t pad3:1;
+		uint8_t ac:1;	// auxillary carry (carry out of bit 3)
+		uint8_t pad5:1;
+		uint8_t z:1;	// zero (1 if result == 0)
+		uint8_t s:1;	// sign (1 if 7th bit is set)
+	};
+	uint8_t psw;
 };
 
+// register encoding used in the opcodes (B C D E H L M A)
+enum reg_index{ REG_B, REG_C, REG_D, REG_E, REG_H, REG_L, REG_M, REG_A };
+
 /**
 	CPU state structure. Contains all registers, the memory array and a check if it allows interrupts.
 */
 typedef struct state_8080{
-	uint8_t a;
-	uint8_t b;
-	uint8_t c;
-	uint8_t d;
-	uint8_t e;
-	uint8_t h;
-	uint8_t l;
+	union{
+		struct{
+			uint8_t b;
+			uint8_t c;
+			uint8_t d;
+			uint8_t e;
+			uint8_t h;
+			uint8_t l;
+			uint8_t unused;	// index 6 encodes M, the memory byte at HL
+			uint8_t a;
+		};
+		uint8_t regs[8];	// register file, indexed by the 8080 register encoding
+	};
 	uint16_t sp;
 	uint16_t pc;
 	uint8_t *memory;
-	struct condition_codes cc;
+	union condition_codes cc;
+
+	// last flag-setting operation, computed into cc by materialize_flags (LAZY_FLAGS builds)
+	uint8_t flags_kind;
+	uint8_t flags_a;
+	uint8_t flags_b;
+	uint8_t flags_answer;
+
 	uint8_t int_enable;
+	uint8_t flat_memory;		// 1 if all 64K are writable (CP/M), 0 for the arcade map with RAM at 2000-3fff only
+	uint32_t vram_dirty[VRAM_COLUMNS / 32];	// VRAM columns written since the machine last took them, a bit each
+
+	uint64_t cycles;			// emulated cycles since reset, advanced by the machine after every run
+	uint64_t instructions;		// instructions executed since reset, counted by the cores
+
+	struct block_cache *cache;	// decoded blocks for emulate_8080_run_cached, NULL if not used
+	struct jit *jit;			// native code for emulate_8080_run_jit, NULL if not used
+	struct opcode_stats *stats;	// counters for emulate_8080_run_stats, NULL if not used
+	struct callgraph *calls;	// call graph for emulate_8080_run_stats, NULL if not used
+	struct trace *trace;		// instruction trace for emulate_8080_op and emulate_8080_run_stats, NULL if not used
 } state_8080;
 
+/**
+	Instruction handler, called with PC already past the opcode byte.
+	@param state: the CPU state
+	@param opcode: the instruction bytes
+*/
+typedef void (*op_handler)(state_8080 *state, uint8_t *opcode);
+
+// cycles taken by every instruction
+extern uint8_t cycles8080[256];
+
+// length in bytes of every instruction
+extern uint8_t lengths8080[256];
+
 
 /**
 	Prints an error message and exits the program when the emulator hits an unimplemented instruction.
@@ -44,22 +109,48 @@ void unimplemented_instruction(state_8080 *state);
 uint8_t emulate_8080_op(state_8080 *state);
 
 /**
-	Emulates a system interrupt.
+	@param opcode: instruction opcode
+	@return the handler that executes the opcode
+*/
+op_handler get_op_handler(uint8_t opcode);
+
+/**
+	Executes instructions until the cycle budget is used up or the next instruction needs the host.
+	Returns early with PC on an IN or OUT instruction, and after EI so a pending interrupt can be taken.
 	@param state: the CPU state
-	@param interrupt_number: the interrupt number (only 1 and 2 used)
+	@param budget: number of cycles to execute
+	@return the number of cycles executed
 */
-void generate_interrupt(state_8080 *state, uint32_t interrupt_number);
+int32_t emulate_8080_run(state_8080 *state, int32_t budget);
+
+/**
+	Same as emulate_8080_run, but also records every instruction into whichever of state->trace
+	(instruction trace, trace.h), state->stats (opcode counters, opcode_stats.h) and state->calls
+	(call graph, callgraph.h) is set. A separate build of the same core, so emulate_8080_run
+	doesn't pay for the counters.
+	@param state: the CPU state, with trace, stats or calls set
+	@param budget: number of cycles to execute
+	@return the number of cycles executed
+*/
+int32_t emulate_8080_run_stats(state_8080 *state, int32_t budget);
 
 /**
-	Calculates the parity of an integer (number of 1s in the binary representation).
-	@param x: the number
-	@param size: bit width
-	@return 1 if even number of 1s, 0 if odd number of 1s
+	Computes the condition codes from the pending flag-setting operation, if any.
+	Call it before reading state->cc from outside the core.
+	@param state: the CPU state
+*/
+void materialize_flags(state_8080 *state);
+
+/**
+	Emulates a system interrupt.
+	@param state: the CPU state
+	@param interrupt_number: the interrupt number (only 1 and 2 used)
 */
-uint32_t parity(uint32_t x, uint32_t size);
+void generate_interrupt(state_8080 *state, uint32_t interrupt_number);
 
 /**
-	Wraps the memory writing operation so it blocks attempted writes to the ROM.
+	Wraps the memory writing operation so it blocks attempted writes to the ROM, unless the
+	memory is flat, and marks the VRAM columns written.
 	@param state: the CPU state
 	@param addr: RAM address
 	@param val: value to write
@@ -0,0 +1,1088 @@
+#include <stdint.h>
+#include "emulator.h"
+
+#pragma once
+
+/*
+	Flag tables, flag helpers and the instruction handlers of the core. Only meant to be included
+	by emulator.cpp and by code that calls the handlers directly (the static recompiler output), so
+	every user gets its own inlined copy.
+*/
+
+// 1 to only record the last flag-setting operation and compute the flags when they are read
+// (conditional jumps/calls/returns, PUSH PSW, carry users and materialize_flags).
+#ifndef LAZY_FLAGS
+#define LAZY_FLAGS 0
+#endif
+
+/**
+	Sign, zero and parity flags (plus the always set bit 1) of every 8 bit result.
+*/
+static const uint8_t szp_table[] = {
+	0x46, 0x02, 0x02, 0x06, 0x02, 0x06, 0x06, 0x02, 0x02, 0x06, 0x06, 0x02, 0x06, 0x02, 0x02, 0x06, //0x00..0x0f
+	0x02, 0x06, 0x06, 0x02, 0x06, 0x02, 0x02, 0x06, 0x06, 0x02, 0x02, 0x06, 0x02, 0x06, 0x06, 0x02, //0x10..0x1f
+	0x02, 0x06, 0x06, 0x02, 0x06, 0x02, 0x02, 0x06, 0x06, 0x02, 0x02, 0x06, 0x02, 0x06, 0x06, 0x02, //0x20..0x2f
+	0x06, 0x02, 0x02, 0x06, 0x02, 0x06, 0x06, 0x02, 0x02, 0x06, 0x06, 0x02, 0x06, 0x02, 0x02, 0x06, //0x30..0x3f
+	0x02, 0x06, 0x06, 0x02, 0x06, 0x02, 0x02, 0x06, 0x06, 0x02, 0x02, 0x06, 0x02, 0x06, 0x06, 0x02, //0x40..0x4f
+	0x06, 0x02, 0x02, 0x06, 0x02, 0x06, 0x06, 0x02, 0x02, 0x06, 0x06, 0x02, 0x06, 0x02, 0x02, 0x06, //0x50..0x5f
+	0x06, 0x02, 0x02, 0x06, 0x02, 0x06, 0x06, 0x02, 0x02, 0x06, 0x06, 0x02, 0x06, 0x02, 0x02, 0x06, //0x60..0x6f
+	0x02, 0x06, 0x06, 0x02, 0x06, 0x02, 0x02, 0x06, 0x06, 0x02, 0x02, 0x06, 0x02, 0x06, 0x06, 0x02, //0x70..0x7f
+	0x82, 0x86, 0x86, 0x82, 0x86, 0x82, 0x82, 0x86, 0x86, 0x82, 0x82, 0x86, 0x82, 0x86, 0x86, 0x82, //0x80..0x8f
+	0x86, 0x82, 0x82, 0x86, 0x82, 0x86, 0x86, 0x82, 0x82, 0x86, 0x86, 0x82, 0x86, 0x82, 0x82, 0x86, //0x90..0x9f
+	0x86, 0x82, 0x82, 0x86, 0x82, 0x86, 0x86, 0x82, 0x82, 0x86, 0x86, 0x82, 0x86, 0x82, 0x82, 0x86, //0xa0..0xaf
+	0x82, 0x86, 0x86, 0x82, 0x86, 0x82, 0x82, 0x86, 0x86, 0x82, 0x82, 0x86, 0x82, 0x86, 0x86, 0x82, //0xb0..0xbf
+	0x86, 0x82, 0x82, 0x86, 0x82, 0x86, 0x86, 0x82, 0x82, 0x86, 0x86, 0x82, 0x86, 0x82, 0x82, 0x86, //0xc0..0xcf
+	0x82, 0x86, 0x86, 0x82, 0x86, 0x82, 0x82, 0x86, 0x86, 0x82, 0x82, 0x86, 0x82, 0x86, 0x86, 0x82, //0xd0..0xdf
+	0x82, 0x86, 0x86, 0x82, 0x86, 0x82, 0x82, 0x86, 0x86, 0x82, 0x82, 0x86, 0x82, 0x86, 0x86, 0x82, //0xe0..0xef
+	0x86, 0x82, 0x82, 0x86, 0x82, 0x86, 0x86, 0x82, 0x82, 0x86, 0x86, 0x82, 0x86, 0x82, 0x82, 0x86, //0xf0..0xff
+};
+
+/**
+	SZP and auxiliary carry flags of the result of INR (carry is not affected).
+*/
+static const uint8_t inr_table[] = {
+	0x56, 0x02, 0x02, 0x06, 0x02, 0x06, 0x06, 0x02, 0x02, 0x06, 0x06, 0x02, 0x06, 0x02, 0x02, 0x06, //0x00..0x0f
+	0x12, 0x06, 0x06, 0x02, 0x06, 0x02, 0x02, 0x06, 0x06, 0x02, 0x02, 0x06, 0x02, 0x06, 0x06, 0x02, //0x10..0x1f
+	0x12, 0x06, 0x06, 0x02, 0x06, 0x02, 0x02, 0x06, 0x06, 0x02, 0x02, 0x06, 0x02, 0x06, 0x06, 0x02, //0x20..0x2f
+	0x16, 0x02, 0x02, 0x06, 0x02, 0x06, 0x06, 0x02, 0x02, 0x06, 0x06, 0x02, 0x06, 0x02, 0x02, 0x06, //0x30..0x3f
+	0x12, 0x06, 0x06, 0x02, 0x06, 0x02, 0x02, 0x06, 0x06, 0x02, 0x02, 0x06, 0x02, 0x06, 0x06, 0x02, //0x40..0x4f
+	0x16, 0x02, 0x02, 0x06, 0x02, 0x06, 0x06, 0x02, 0x02, 0x06, 0x06, 0x02, 0x06, 0x02, 0x02, 0x06, //0x50..0x5f
+	0x16, 0x02, 0x02, 0x06, 0x02, 0x06, 0x06, 0x02, 0x02, 0x06, 0x06, 0x02, 0x06, 0x02, 0x02, 0x06, //0x60..0x6f
+	0x12, 0x06, 0x06, 0x02, 0x06, 0x02, 0x02, 0x06, 0x06, 0x02, 0x02, 0x06, 0x02, 0x06, 0x06, 0x02, //0x70..0x7f
+	0x92, 0x86, 0x86, 0x82, 0x86, 0x82, 0x82, 0x86, 0x86, 0x82, 0x82, 0x86, 0x82, 0x86, 0x86, 0x82, //0x80..0x8f
+	0x96, 0x82, 0x82, 0x86, 0x82, 0x86, 0x86, 0x82, 0x82, 0x86, 0x86, 0x82, 0x86, 0x82, 0x82, 0x86, //0x90..0x9f
+	0x96, 0x82, 0x82, 0x86, 0x82, 0x86, 0x86, 0x82, 0x82, 0x86, 0x86, 0x82, 0x86, 0x82, 0x82, 0x86, //0xa0..0xaf
+	0x92, 0x86, 0x86, 0x82, 0x86, 0x82, 0x82, 0x86, 0x86, 0x82, 0x82, 0x86, 0x82, 0x86, 0x86, 0x82, //0xb0..0xbf
+	0x96, 0x82, 0x82, 0x86, 0x82, 0x86, 0x86, 0x82, 0x82, 0x86, 0x86, 0x82, 0x86, 0x82, 0x82, 0x86, //0xc0..0xcf
+	0x92, 0x86, 0x86, 0x82, 0x86, 0x82, 0x82, 0x86, 0x86, 0x82, 0x82, 0x86, 0x82, 0x86, 0x86, 0x82, //0xd0..0xdf
+	0x92, 0x86, 0x86, 0x82, 0x86, 0x82, 0x82, 0x86, 0x86, 0x82, 0x82, 0x86, 0x82, 0x86, 0x86, 0x82, //0xe0..0xef
+	0x96, 0x82, 0x82, 0x86, 0x82, 0x86, 0x86, 0x82, 0x82, 0x86, 0x86, 0x82, 0x86, 0x82, 0x82, 0x86, //0xf0..0xff
+};
+
+/**
+	SZP and auxiliary carry flags of the result of DCR (carry is not affected).
+*/
+static const uint8_t dcr_table[] = {
+	0x56, 0x12, 0x12, 0x16, 0x12, 0x16, 0x16, 0x12, 0x12, 0x16, 0x16, 0x12, 0x16, 0x12, 0x12, 0x06, //0x00..0x0f
+	0x12, 0x16, 0x16, 0x12, 0x16, 0x12, 0x12, 0x16, 0x16, 0x12, 0x12, 0x16, 0x12, 0x16, 0x16, 0x02, //0x10..0x1f
+	0x12, 0x16, 0x16, 0x12, 0x16, 0x12, 0x12, 0x16, 0x16, 0x12, 0x12, 0x16, 0x12, 0x16, 0x16, 0x02, //0x20..0x2f
+	0x16, 0x12, 0x12, 0x16, 0x12, 0x16, 0x16, 0x12, 0x12, 0x16, 0x16, 0x12, 0x16, 0x12, 0x12, 0x06, //0x30..0x3f
+	0x12, 0x16, 0x16, 0x12, 0x16, 0x12, 0x12, 0x16, 0x16, 0x12, 0x12, 0x16, 0x12, 0x16, 0x16, 0x02, //0x40..0x4f
+	0x16, 0x12, 0x12, 0x16, 0x12, 0x16, 0x16, 0x12, 0x12, 0x16, 0x16, 0x12, 0x16, 0x12, 0x12, 0x06, //0x50..0x5f
+	0x16, 0x12, 0x12, 0x16, 0x12, 0x16, 0x16, 0x12, 0x12, 0x16, 0x16, 0x12, 0x16, 0x12, 0x12, 0x06, //0x60..0x6f
+	0x12, 0x16, 0x16, 0x12, 0x16, 0x12, 0x12, 0x16, 0x16, 0x12, 0x12, 0x16, 0x12, 0x16, 0x16, 0x02, //0x70..0x7f
+	0x92, 0x96, 0x96, 0x92, 0x96, 0x92, 0x92, 0x96, 0x96, 0x92, 0x92, 0x96, 0x92, 0x96, 0x96, 0x82, //0x80..0x8f
+	0x96, 0x92, 0x92, 0x96, 0x92, 0x96, 0x96, 0x92, 0x92, 0x96, 0x96, 0x92, 0x96, 0x92, 0x92, 0x86, //0x90..0x9f
+	0x96, 0x92, 0x92, 0x96, 0x92, 0x96, 0x96, 0x92, 0x92, 0x96, 0x96, 0x92, 0x96, 0x92, 0x92, 0x86, //0xa0..0xaf
+	0x92, 0x96, 0x96, 0x92, 0x96, 0x92, 0x92, 0x96, 0x96, 0x92, 0x92, 0x96, 0x92, 0x96, 0x96, 0x82, //0xb0..0xbf
+	0x96, 0x92, 0x92, 0x96, 0x92, 0x96, 0x96, 0x92, 0x92, 0x96, 0x96, 0x92, 0x96, 0x92, 0x92, 0x86, //0xc0..0xcf
+	0x92, 0x96, 0x96, 0x92, 0x96, 0x92, 0x92, 0x96, 0x96, 0x92, 0x92, 0x96, 0x92, 0x96, 0x96, 0x82, //0xd0..0xdf
+	0x92, 0x96, 0x96, 0x92, 0x96, 0x92, 0x92, 0x96, 0x96, 0x92, 0x92, 0x96, 0x92, 0x96, 0x96, 0x82, //0xe0..0xef
+	0x96, 0x92, 0x92, 0x96, 0x92, 0x96, 0x96, 0x92, 0x92, 0x96, 0x96, 0x92, 0x96, 0x92, 0x92, 0x86, //0xf0..0xff
+};
+
+/**
+	Carry and auxiliary carry of an addition, indexed by bits 7 and 3 of both operands and the result
+	(see carry_index).
+*/
+static const uint8_t add_table[] = {
+	0x00, 0x00, 0x10, 0x00, 0x10, 0x00, 0x10, 0x10, 0x00, 0x00, 0x10, 0x00, 0x10, 0x00, 0x10, 0x10, //0x00..0x0f
+	0x00, 0x00, 0x10, 0x00, 0x10, 0x00, 0x10, 0x10, 0x00, 0x00, 0x10, 0x00, 0x10, 0x00, 0x10, 0x10, //0x10..0x1f
+	0x01, 0x01, 0x11, 0x01, 0x11, 0x01, 0x11, 0x11, 0x01, 0x01, 0x11, 0x01, 0x11, 0x01, 0x11, 0x11, //0x20..0x2f
+	0x00, 0x00, 0x10, 0x00, 0x10, 0x00, 0x10, 0x10, 0x00, 0x00, 0x10, 0x00, 0x10, 0x00, 0x10, 0x10, //0x30..0x3f
+	0x01, 0x01, 0x11, 0x01, 0x11, 0x01, 0x11, 0x11, 0x01, 0x01, 0x11, 0x01, 0x11, 0x01, 0x11, 0x11, //0x40..0x4f
+	0x00, 0x00, 0x10, 0x00, 0x10, 0x00, 0x10, 0x10, 0x00, 0x00, 0x10, 0x00, 0x10, 0x00, 0x10, 0x10, //0x50..0x5f
+	0x01, 0x01, 0x11, 0x01, 0x11, 0x01, 0x11, 0x11, 0x01, 0x01, 0x11, 0x01, 0x11, 0x01, 0x11, 0x11, //0x60..0x6f
+	0x01, 0x01, 0x11, 0x01, 0x11, 0x01, 0x11, 0x11, 0x01, 0x01, 0x11, 0x01, 0x11, 0x01, 0x11, 0x11, //0x70..0x7f
+};
+
+/**
+	Carry (borrow) and auxiliary carry of a subtraction, indexed like add_table.
+	The 8080 sets AC on subtraction when there is no borrow out of bit 3.
+*/
+static const uint8_t sub_table[] = {
+	0x10, 0x00, 0x00, 0x00, 0x10, 0x10, 0x10, 0x00, 0x10, 0x00, 0x00, 0x00, 0x10, 0x10, 0x10, 0x00, //0x00..0x0f
+	0x11, 0x01, 0x01, 0x01, 0x11, 0x11, 0x11, 0x01, 0x11, 0x01, 0x01, 0x01, 0x11, 0x11, 0x11, 0x01, //0x10..0x1f
+	0x11, 0x01, 0x01, 0x01, 0x11, 0x11, 0x11, 0x01, 0x11, 0x01, 0x01, 0x01, 0x11, 0x11, 0x11, 0x01, //0x20..0x2f
+	0x11, 0x01, 0x01, 0x01, 0x11, 0x11, 0x11, 0x01, 0x11, 0x01, 0x01, 0x01, 0x11, 0x11, 0x11, 0x01, //0x30..0x3f
+	0x10, 0x00, 0x00, 0x00, 0x10, 0x10, 0x10, 0x00, 0x10, 0x00, 0x00, 0x00, 0x10, 0x10, 0x10, 0x00, //0x40..0x4f
+	0x10, 0x00, 0x00, 0x00, 0x10, 0x10, 0x10, 0x00, 0x10, 0x00, 0x00, 0x00, 0x10, 0x10, 0x10, 0x00, //0x50..0x5f
+	0x10, 0x00, 0x00, 0x00, 0x10, 0x10, 0x10, 0x00, 0x10, 0x00, 0x00, 0x00, 0x10, 0x10, 0x10, 0x00, //0x60..0x6f
+	0x11, 0x01, 0x01, 0x01, 0x11, 0x11, 0x11, 0x01, 0x11, 0x01, 0x01, 0x01, 0x11, 0x11, 0x11, 0x01, //0x70..0x7f
+};
+
+
+/**
+	Builds the index into add_table/sub_table from bits 7 and 3 of the two operands and the result.
+	@param a: first operand
+	@param b: second operand
+	@param answer: 8 bit result
+	@return table index (0..0x77)
+*/
+static inline uint8_t carry_index(uint8_t a, uint8_t b, uint8_t answer){
+	return ((a & 0x88) >> 1) | ((b & 0x88) >> 2) | ((answer & 0x88) >> 3);
+}
+
+/**
+	Computes the PSW after a flag-setting operation.
+	@param kind: the operation (enum flags_kind)
+	@param a: first operand
+	@param b: second operand
+	@param answer: 8 bit result
+	@param psw: the PSW before the operation (INR/DCR keep its carry)
+	@return the new PSW
+*/
+static inline uint8_t compute_flags(uint8_t kind, uint8_t a, uint8_t b, uint8_t answer, uint8_t psw){
+	switch(kind){
+		case FLAGS_ADD:
+			return szp_table[answer] | add_table[carry_index(a, b, answer)];
+		case FLAGS_SUB:
+			return szp_table[answer] | sub_table[carry_index(a, b, answer)];
+		case FLAGS_ANA:
+			// carry is cleared, AC is the OR of bit 3 of the operands
+			return szp_table[answer] | (((a | b) & 0x08) << 1);
+		case FLAGS_LOGIC:
+			// carry and AC are cleared
+			return szp_table[answer];
+		case FLAGS_INR:
+			return (psw & FLAG_CY) | inr_table[answer];
+		case FLAGS_DCR:
+			return (psw & FLAG_CY) | dcr_table[answer];
+	}
+	return psw;
+}
+
+/**
+	Updates the flags after an operation. With LAZY_FLAGS the operation is only recorded and the
+	flags are computed by materialize_flags when something reads them.
+	@param state: the CPU state
+	@param kind: the operation (enum flags_kind)
+	@param a: first operand
+	@param b: second operand
+	@param answer: 8 bit result
+*/
+static inline void set_flags(state_8080 *state, uint8_t kind, uint8_t a, uint8_t b, uint8_t answer){
+#if LAZY_FLAGS
+	if((kind == FLAGS_INR || kind == FLAGS_DCR) && state->flags_kind != FLAGS_INR && state->flags_kind != FLAGS_DCR){
+		// INR/DCR keep the carry, which is only valid in the PSW once the previous operation is computed
+		materialize_flags(state);
+	}
+	state->flags_kind = kind;
+	state->flags_a = a;
+	state->flags_b = b;
+	state->flags_answer = answer;
+#else
+	state->cc.psw = compute_flags(kind, a, b, answer, state->cc.psw);
+#endif
+}
+
+/**
+	@return the condition codes, computing them first if an operation is pending.
+*/
+static inline union condition_codes &flags(state_8080 *state){
+#if LAZY_FLAGS
+	materialize_flags(state);
+#endif
+	return state->cc;
+}
+
+/**
+	@return the zero flag. It only depends on the result, so it never forces the other flags.
+*/
+static inline uint8_t flag_z(state_8080 *state){
+#if LAZY_FLAGS
+	if(state->flags_kind != FLAGS_NONE){
+		return state->flags_answer == 0;
+	}
+#endif
+	return state->cc.z;
+}
+
+/**
+	@return the sign flag. It only depends on the result, so it never forces the other flags.
+*/
+static inline uint8_t flag_s(state_8080 *state){
+#if LAZY_FLAGS
+	if(state->flags_kind != FLAGS_NONE){
+		return state->flags_answer >> 7;
+	}
+#endif
+	return state->cc.s;
+}
+
+// Shorthands for the flag-setting instruction groups
+static inline void flags_add(state_8080 *state, uint8_t a, uint8_t b, uint8_t answer){
+	set_flags(state, FLAGS_ADD, a, b, answer);
+}
+
+static inline void flags_sub(state_8080 *state, uint8_t a, uint8_t b, uint8_t answer){
+	set_flags(state, FLAGS_SUB, a, b, answer);
+}
+
+static inline void flags_ana(state_8080 *state, uint8_t a, uint8_t b){
+	set_flags(state, FLAGS_ANA, a, b, a & b);
+}
+
+static inline void flags_logic(state_8080 *state, uint8_t answer){
+	set_flags(state, FLAGS_LOGIC, 0, 0, answer);
+}
+
+static inline void flags_inr(state_8080 *state, uint8_t answer){
+	set_flags(state, FLAGS_INR, 0, 0, answer);
+}
+
+static inline void flags_dcr(state_8080 *state, uint8_t answer){
+	set_flags(state, FLAGS_DCR, 0, 0, answer);
+}
+
+/*
+	Instruction handlers, one per opcode. They are called with state->pc already pointing past
+	the opcode byte and opcode pointing at the instruction in memory.
+
+	The register families (MOV, MVI, INR, DCR and the ALU block) only differ in the register
+	index encoded in the opcode, so they are generated from templates over the register file.
+	Every other opcode is an explicit specialization of op<>.
+*/
+
+/**
+	Reads an 8080 register by its encoding (B C D E H L M A), M being the byte at HL.
+*/
+template<int R> static inline uint8_t get_reg(state_8080 *state){
+	if constexpr(R == REG_M){
+		return state->memory[(state->h << 8) | state->l];
+	}
+	else{
+		return state->regs[R];
+	}
+}
+
+/**
+	Writes an 8080 register by its encoding (B C D E H L M A), M being the byte at HL.
+*/
+template<int R> static inline void set_reg(state_8080 *state, uint8_t val){
+	if constexpr(R == REG_M){
+		write_ram(state, (state->h << 8) | state->l, val);
+	}
+	else{
+		state->regs[R] = val;
+	}
+}
+
+// ALU operations, in the order of their encoding in bits 3..5 of the opcode
+enum alu_op{ ALU_ADD, ALU_ADC, ALU_SUB, ALU_SBB, ALU_ANA, ALU_XRA, ALU_ORA, ALU_CMP };
+
+/**
+	Applies an ALU operation to the accumulator and sets the flags.
+	@param state: the CPU state
+	@param value: second operand
+*/
+template<int OP> static inline void alu(state_8080 *state, uint8_t value){
+	uint8_t answer;
+	if constexpr(OP == ALU_ADD || OP == ALU_ADC){
+		answer = state->a + value + (OP == ALU_ADC ? flags(state).cy : 0);
+		flags_add(state, state->a, value, answer);
+	}
+	else if constexpr(OP == ALU_SUB || OP == ALU_SBB || OP == ALU_CMP){
+		answer = state->a - value - (OP == ALU_SBB ? flags(state).cy : 0);
+		flags_sub(state, state->a, value, answer);
+		if constexpr(OP == ALU_CMP){
+			return;
+		}
+	}
+	else if constexpr(OP == ALU_ANA){
+		flags_ana(state, state->a, value);
+		answer = state->a & value;
+	}
+	else{
+		answer = (OP == ALU_XRA) ? (state->a ^ value) : (state->a | value);
+		flags_logic(state, answer);
+	}
+	state->a = answer;
+}
+
+/**
+	Generic opcode handler. MOV r,r (0x40..0x7f), MVI r (00rrr110), INR r (00rrr100), DCR r (00rrr101),
+	the ALU block (0x80..0xbf) and the ALU immediates (11ooo110) are decoded from the opcode bits at
+	compile time.
+*/
+template<uint8_t OP> inline void op(state_8080 *state, uint8_t *opcode){
+	constexpr int dst = (OP >> 3) & 7;
+	constexpr int src = OP & 7;
+
+	if constexpr((OP & 0xc0) == 0x40){
+		// MOV dst, src
+		set_reg<dst>(state, get_reg<src>(state));
+	}
+	else if constexpr((OP & 0xc7) == 0x06){
+		// MVI dst, d8
+		set_reg<dst>(state, opcode[1]);
+		state->pc += 1;
+	}
+	else if constexpr((OP & 0xc7) == 0x04){
+		// INR dst
+		uint8_t answer = get_reg<dst>(state) + 1;
+		flags_inr(state, answer);
+		set_reg<dst>(state, answer);
+	}
+	else if constexpr((OP & 0xc7) == 0x05){
+		// DCR dst
+		uint8_t answer = get_reg<dst>(state) - 1;
+		flags_dcr(state, answer);
+		set_reg<dst>(state, answer);
+	}
+	else if constexpr((OP & 0xc0) == 0x80){
+		// ADD/ADC/SUB/SBB/ANA/XRA/ORA/CMP src
+		alu<dst>(state, get_reg<src>(state));
+	}
+	else if constexpr((OP & 0xc7) == 0xc6){
+		// ADI/ACI/SUI/SBI/ANI/XRI/ORI/CPI d8
+		alu<dst>(state, opcode[1]);
+		state->pc += 1;
+	}
+	else{
+		static_assert(OP != OP, "opcode needs an explicit handler");
+	}
+}
+
+template<> inline void op<0x00>(state_8080 *state, uint8_t *opcode){
+	// NOP
+}
+
+template<> inline void op<0x01>(state_8080 *state, uint8_t *opcode){
+	// LXI B, d16
+	state->c = opcode[1];
+	state->b = opcode[2];
+	state->pc += 2;
+}
+
+template<> inline void op<0x02>(state_8080 *state, uint8_t *opcode){
+	// STAX B
+	uint16_t offset = (state->b << 8) | (state->c);
+	write_ram(state, offset, state->a);
+}
+
+template<> inline void op<0x03>(state_8080 *state, uint8_t *opcode){
+	// INX B
+	state->c++;
+	if(state->c == 0){
+		state->b++;
+	}
+}
+
+template<> inline void op<0x07>(state_8080 *state, uint8_t *opcode){
+	// RLC
+	uint8_t answer = state->a;
+	state->a = ((answer & 0x80) >> 7) | (answer << 1);
+	flags(state).cy = (0x80 == (answer & 0x80));
+}
+
+template<> inline void op<0x08>(state_8080 *state, uint8_t *opcode){
+	// undocumented NOP
+}
+
+template<> inline void op<0x09>(state_8080 *state, uint8_t *opcode){
+	// DAD B
+	uint32_t bc = (state->b << 8) | (state->c);
+	uint32_t hl = (state->h << 8) | (state->l);
+	uint32_t answer = bc + hl;
+	state->h = (answer >> 8) & 0xff;
+	state->l = answer & 0xff;
+	flags(state).cy = (answer > 0xffff);
+}
+
+template<> inline void op<0x0A>(state_8080 *state, uint8_t *opcode){
+	// LDAX B
+	uint16_t offset = (state->b << 8) | state->c;
+	state->a = state->memory[offset];
+}
+
+template<> inline void op<0x0B>(state_8080 *state, uint8_t *opcode){
+	state->c -= 1;
+	if(state->c == 0xff){
+		state->b -=1;
+	}
+}
+
+template<> inline void op<0x0F>(state_8080 *state, uint8_t *opcode){
+	// RRC
+	uint8_t low = state->a & 0x1;
+	state->a = (low << 7) | (state->a >> 1);
+	flags(state).cy = (low == 1);
+}
+
+template<> inline void op<0x10>(state_8080 *state, uint8_t *opcode){
+	// undocumented NOP
+}
+
+template<> inline void op<0x11>(state_8080 *state, uint8_t *opcode){
+	// LXI D, d16
+	state->e = opcode[1];
+	state->d = opcode[2];
+	state->pc += 2;
+}
+
+template<> inline void op<0x12>(state_8080 *state, uint8_t *opcode){
+	// STAX D
+	uint16_t offset = (state->d << 8) | (state->e);
+	write_ram(state, offset, state->a);
+}
+
+template<> inline void op<0x13>(state_8080 *state, uint8_t *opcode){
+	// INX D
+	state->e++;
+	if(state->e == 0){
+		state->d++;
+	}
+}
+
+template<> inline void op<0x17>(state_8080 *state, uint8_t *opcode){
+	// RAL
+	uint8_t answer = state->a;
+	state->a = flags(state).cy | (answer << 1);
+	flags(state).cy = (0x80 == (answer&0x80));
+}
+
+template<> inline void op<0x18>(state_8080 *state, uint8_t *opcode){
+	// undocumented NOP
+}
+
+template<> inline void op<0x19>(state_8080 *state, uint8_t *opcode){
+	// DAD D
+	uint32_t de = (state->d << 8) | (state->e);
+	uint32_t hl = (state->h << 8) | (state->l);
+	uint32_t answer = de + hl;
+	state->h = (uint8_t)(answer >> 8) & 0xff;
+	state->l = (uint8_t)answer & 0xff;
+	flags(state).cy = (answer > 0xffff);
+}
+
+template<> inline void op<0x1A>(state_8080 *state, uint8_t *opcode){
+	// LDAX D
+	uint32_t offset = (state->d << 8) | (state->e);
+	state->a = state->memory[offset];
+}
+
+template<> inline void op<0x1B>(state_8080 *state, uint8_t *opcode){
+	// DCX D
+	state->e -= 1;
+	if(state->e == 0xff){
+		state->d -=1;
+	}
+}
+
+template<> inline void op<0x1F>(state_8080 *state, uint8_t *opcode){
+	// RAR
+	uint8_t answer = state->a;
+	state->a = (flags(state).cy << 7) | (answer >>1);
+	flags(state).cy = (1 == (answer & 1));
+}
+
+template<> inline void op<0x20>(state_8080 *state, uint8_t *opcode){
+	// undocumented NOP
+}
+
+template<> inline void op<0x21>(state_8080 *state, uint8_t *opcode){
+	// LXI H, d16
+	state->l = opcode[1];
+	state->h = opcode[2];
+	state->pc += 2;
+}
+
+template<> inline void op<0x22>(state_8080 *state, uint8_t *opcode){
+	// SHDL d16
+	uint32_t offset = (opcode[2] << 8) | opcode[1];
+	write_ram(state, offset, state->l);
+	write_ram(state, offset + 1, state->h);
+	state->pc += 2;
+}
+
+template<> inline void op<0x23>(state_8080 *state, uint8_t *opcode){
+	// INX H
+	state->l++;
+	if(state->l == 0){
+		state->h++;
+	}
+}
+
+template<> inline void op<0x27>(state_8080 *state, uint8_t *opcode){
+	// DAA
+	uint8_t correction = 0;
+	uint8_t carry = flags(state).cy;
+	if(flags(state).ac || (state->a & 0xf) > 9){
+		correction |= 0x06;
+	}
+	if(flags(state).cy || state->a > 0x99){
+		correction |= 0x60;
+		carry = 1;
+	}
+	uint8_t answer = state->a + correction;
+	flags_add(state, state->a, correction, answer);
+	flags(state).cy = carry;
+	state->a = answer;
+}
+
+template<> inline void op<0x28>(state_8080 *state, uint8_t *opcode){
+	// undocumented NOP
+}
+
+template<> inline void op<0x29>(state_8080 *state, uint8_t *opcode){
+	// DAD H
+	uint32_t hl = (state->h << 8) | (state->l);
+	uint32_t answer = hl << 1;
+	state->h = (uint8_t)(answer >> 8) & 0xff;
+	state->l = (uint8_t)answer & 0xff;
+	flags(state).cy = (answer > 0xffff);
+}
+
+template<> inline void op<0x2A>(state_8080 *state, uint8_t *opcode){
+	// LHDL d16
+	uint16_t offset = (opcode[2] << 8) | opcode[1];
+	state->l = state->memory[offset];
+	state->h = state->memory[offset+1];
+	state->pc += 2;
+}
+
+template<> inline void op<0x2B>(state_8080 *state, uint8_t *opcode){
+	// DCX H
+	state->l -= 1;
+	if(state->l == 0xff){
+		state->h -= 1;
+	}
+}
+
+template<> inline void op<0x2F>(state_8080 *state, uint8_t *opcode){
+	// CMA
+	state->a = ~state->a;
+}
+
+template<> inline void op<0x30>(state_8080 *state, uint8_t *opcode){
+	// undocumented NOP
+}
+
+template<> inline void op<0x31>(state_8080 *state, uint8_t *opcode){
+	// LXI SP, d16
+	state->sp = (opcode[2] << 8) | opcode[1];
+	state->pc += 2;
+}
+
+template<> inline void op<0x32>(state_8080 *state, uint8_t *opcode){
+	// STA addr
+	uint16_t offset = (opcode[2] << 8) | opcode[1];
+	write_ram(state, offset, state->a);
+	state->pc += 2;
+}
+
+template<> inline void op<0x33>(state_8080 *state, uint8_t *opcode){
+	// INX SP
+	state->sp++;
+}
+
+template<> inline void op<0x37>(state_8080 *state, uint8_t *opcode){
+	// STC
+	flags(state).cy = 1;
+}
+
+template<> inline void op<0x38>(state_8080 *state, uint8_t *opcode){
+	// undocumented NOP
+}
+
+template<> inline void op<0x39>(state_8080 *state, uint8_t *opcode){
+	//DAD SP
+	uint32_t hl = (state->h << 8) | state->l;
+	uint32_t res = hl + state->sp;
+	state->h = (res & 0xff00) >> 8;
+	state->l = res & 0xff;
+	flags(state).cy = ((res & 0xffff0000) > 0);
+}
+
+template<> inline void op<0x3A>(state_8080 *state, uint8_t *opcode){
+	// LDA addr
+	uint16_t offset = (opcode[2] << 8) | opcode[1];
+	state->a = state->memory[offset];
+	state->pc += 2;
+}
+
+template<> inline void op<0x3B>(state_8080 *state, uint8_t *opcode){
+	// DCX SP
+	state->sp -= 1;
+}
+
+template<> inline void op<0x3F>(state_8080 *state, uint8_t *opcode){
+	// CMC
+	flags(state).cy = !flags(state).cy;
+}
+
+template<> inline void op<0x76>(state_8080 *state, uint8_t *opcode){
+	// HLT
+}
+
+template<> inline void op<0xC0>(state_8080 *state, uint8_t *opcode){
+	// RNZ
+	if(flag_z(state) == 0){
+		state->pc = state->memory[state->sp] | (state->memory[state->sp + 1] << 8);
+		state->sp += 2;
+	}
+}
+
+template<> inline void op<0xC1>(state_8080 *state, uint8_t *opcode){
+	// POP B
+	pop(state, &state->b, &state->c);
+}
+
+template<> inline void op<0xC2>(state_8080 *state, uint8_t *opcode){
+	// JNZ addr
+	if(flag_z(state) == 0){
+		state->pc = (opcode[2] << 8) | opcode[1];
+	}
+	else{
+		state->pc += 2;
+	}
+}
+
+template<> inline void op<0xC3>(state_8080 *state, uint8_t *opcode){
+	// JMP addr
+	state->pc = (opcode[2] << 8) | opcode[1];
+}
+
+template<> inline void op<0xC4>(state_8080 *state, uint8_t *opcode){
+	// CNZ addr
+	if(flag_z(state) == 0){
+		uint16_t offset = (opcode[2] << 8) | opcode[1];
+		uint16_t ret = state->pc + 2;
+		write_ram(state, state->sp-1, (ret >> 8) & 0xff);
+		write_ram(state, state->sp-2, ret & 0xff);
+		state->sp = state->sp - 2;
+		state->pc = offset;
+	}
+	else{
+		state->pc += 2;
+	}
+}
+
+template<> inline void op<0xC5>(state_8080 *state, uint8_t *opcode){
+	// PUSH B
+	push(state, state->b, state->c);
+}
+
+template<> inline void op<0xC7>(state_8080 *state, uint8_t *opcode){
+	// RST 0
+	uint16_t ret = state->pc;
+	write_ram(state, state->sp-1, (ret >> 8) & 0xff);
+	write_ram(state, state->sp-2, ret & 0xff);
+	state->sp = state->sp - 2;
+	state->pc = 0x0000;
+}
+
+template<> inline void op<0xC8>(state_8080 *state, uint8_t *opcode){
+	// RZ
+	if(flag_z(state)){
+		state->pc = state->memory[state->sp] | (state->memory[state->sp + 1] << 8);
+		state->sp += 2;
+	}
+}
+
+template<> inline void op<0xC9>(state_8080 *state, uint8_t *opcode){
+	// RET
+	state->pc = state->memory[state->sp] | (state->memory[state->sp + 1] << 8);
+	state->sp += 2;
+}
+
+template<> inline void op<0xCA>(state_8080 *state, uint8_t *opcode){
+	// JZ addr
+	if(flag_z(state)){
+		state->pc = (opcode[2] << 8) | opcode[1];
+	}
+	else{
+		state->pc += 2;
+	}
+}
+
+template<> inline void op<0xCB>(state_8080 *state, uint8_t *opcode){
+	// JMP
+	state->pc = (opcode[2] << 8) | opcode[1];
+}
+
+template<> inline void op<0xCC>(state_8080 *state, uint8_t *opcode){
+	// CZ addr
+	if(flag_z(state) == 1){
+		uint16_t offset = (opcode[2] << 8) | opcode[1];
+		uint16_t ret = state->pc + 2;
+		write_ram(state, state->sp-1, (ret >> 8) & 0xff);
+		write_ram(state, state->sp-2, ret & 0xff);
+		state->sp = state->sp - 2;
+		state->pc = offset;
+	}
+	else{
+		state->pc += 2;
+	}
+}
+
+template<> inline void op<0xCD>(state_8080 *state, uint8_t *opcode){
+	// CALL addr
+	uint16_t offset = (opcode[2] << 8) | opcode[1];
+	uint16_t ret = state->pc + 2;
+	write_ram(state, state->sp-1, (ret >> 8) & 0xff);
+	write_ram(state, state->sp-2, ret & 0xff);
+	state->sp = state->sp - 2;
+	state->pc = offset;
+}
+
+template<> inline void op<0xCF>(state_8080 *state, uint8_t *opcode){
+	// RST 1
+	uint16_t ret = state->pc;
+	write_ram(state, state->sp-1, (ret >> 8) & 0xff);
+	write_ram(state, state->sp-2, ret & 0xff);
+	state->sp = state->sp - 2;
+	state->pc = 0x0008;
+}
+
+template<> inline void op<0xD0>(state_8080 *state, uint8_t *opcode){
+	// RNC
+	if(flags(state).cy == 0){
+		state->pc = state->memory[state->sp] | (state->memory[state->sp + 1] << 8);
+		state->sp += 2;
+	}
+}
+
+template<> inline void op<0xD1>(state_8080 *state, uint8_t *opcode){
+	// POP D
+	pop(state, &state->d, &state->e);
+}
+
+template<> inline void op<0xD2>(state_8080 *state, uint8_t *opcode){
+	// JNC d16
+	if(flags(state).cy == 0){
+		state->pc = (opcode[2] << 8) | opcode[1];
+	}
+	else{
+		state->pc += 2;
+	}
+}
+
+template<> inline void op<0xD3>(state_8080 *state, uint8_t *opcode){
+	// OUT d8
+	// COMPLETE HERE !!
+	state->pc += 1;
+}
+
+template<> inline void op<0xD4>(state_8080 *state, uint8_t *opcode){
+	// CNC d16
+	if(flags(state).cy == 0){
+		uint16_t offset = (opcode[2] << 8) | opcode[1];
+		uint16_t ret = state->pc + 2;
+		write_ram(state, state->sp-1, (ret >> 8) & 0xff);
+		write_ram(state, state->sp-2, ret & 0xff);
+		state->sp = state->sp - 2;
+		state->pc = offset;
+	}
+	else{
+		state->pc += 2;
+	}
+}
+
+template<> inline void op<0xD5>(state_8080 *state, uint8_t *opcode){
+	// PUSH D
+	push(state, state->d, state->e);
+}
+
+template<> inline void op<0xD7>(state_8080 *state, uint8_t *opcode){
+	// RST 2
+	uint16_t ret = state->pc;
+	write_ram(state, state->sp-1, (ret >> 8) & 0xff);
+	write_ram(state, state->sp-2, ret & 0xff);
+	state->sp = state->sp - 2;
+	state->pc = 0x10;
+}
+
+template<> inline void op<0xD8>(state_8080 *state, uint8_t *opcode){
+	// RC
+	if(flags(state).cy != 0){
+		state->pc = state->memory[state->sp] | (state->memory[state->sp + 1] << 8);
+		state->sp += 2;
+	}
+}
+
+template<> inline void op<0xD9>(state_8080 *state, uint8_t *opcode){
+	// undocumented NOP
+}
+
+template<> inline void op<0xDA>(state_8080 *state, uint8_t *opcode){
+	// JC addr
+	if(flags(state).cy != 0){
+		state->pc = (opcode[2] << 8) | opcode[1];
+	}
+	else{
+		state->pc += 2;
+	}
+}
+
+template<> inline void op<0xDB>(state_8080 *state, uint8_t *opcode){
+	// IN
+	// COMPLETE HERE !!
+	state->pc += 1;
+}
+
+template<> inline void op<0xDC>(state_8080 *state, uint8_t *opcode){
+	// CC addr
+	if(flags(state).cy != 0){
+		uint16_t offset = (opcode[2] << 8) | opcode[1];
+		uint16_t ret = state->pc + 2;
+		write_ram(state, state->sp-1, (ret >> 8) & 0xff);
+		write_ram(state, state->sp-2, ret & 0xff);
+		state->sp = state->sp - 2;
+		state->pc = offset;
+	}
+	else{
+		state->pc += 2;
+	}
+}
+
+template<> inline void op<0xDD>(state_8080 *state, uint8_t *opcode){
+	// undocumented NOP
+}
+
+template<> inline void op<0xDF>(state_8080 *state, uint8_t *opcode){
+	// RST 3
+	uint16_t ret = state->pc;
+	write_ram(state, state->sp-1, (ret >> 8) & 0xff);
+	write_ram(state, state->sp-2, ret & 0xff);
+	state->sp = state->sp - 2;
+	state->pc = 0x18;
+}
+
+template<> inline void op<0xE0>(state_8080 *state, uint8_t *opcode){
+	// RPO
+	if(flags(state).p == 0){
+		state->pc = state->memory[state->sp] | (state->memory[state->sp + 1] << 8);
+		state->sp += 2;
+	}
+}
+
+template<> inline void op<0xE1>(state_8080 *state, uint8_t *opcode){
+	// POP H
+	pop(state, &state->h, &state->l);
+}
+
+template<> inline void op<0xE2>(state_8080 *state, uint8_t *opcode){
+	// JPO
+	if(flags(state).p == 0){
+		state->pc = (opcode[2] << 8) | opcode[1];
+	}
+	else{
+		state->pc += 2;
+	}
+}
+
+template<> inline void op<0xE3>(state_8080 *state, uint8_t *opcode){
+	// XTHL
+	uint8_t h = state->h;
+	uint8_t l = state->l;
+	state->l = state->memory[state->sp];
+	state->h = state->memory[state->sp + 1];
+	write_ram(state, state->sp, l);
+	write_ram(state, state->sp+1, h);
+}
+
+template<> inline void op<0xE4>(state_8080 *state, uint8_t *opcode){
+	// CPO addr
+	if(flags(state).p == 0){
+		uint16_t offset = (opcode[2] << 8) | opcode[1];
+		uint16_t ret = state->pc + 2;
+		write_ram(state, state->sp-1, (ret >> 8) & 0xff);
+		write_ram(state, state->sp-2, ret & 0xff);
+		state->sp = state->sp - 2;
+		state->pc = offset;
+	}
+	else{
+		state->pc += 2;
+	}
+}
+
+template<> inline void op<0xE5>(state_8080 *state, uint8_t *opcode){
+	// PUSH H
+	push(state, state->h, state->l);
+}
+
+template<> inline void op<0xE7>(state_8080 *state, uint8_t *opcode){
+	// RST 4
+	uint16_t ret = state->pc;
+	write_ram(state, state->sp-1, (ret >> 8) & 0xff);
+	write_ram(state, state->sp-2, ret & 0xff);
+	state->sp = state->sp - 2;
+	state->pc = 0x20;
+}
+
+template<> inline void op<0xE8>(state_8080 *state, uint8_t *opcode){
+	// RPE
+	if(flags(state).p != 0){
+		state->pc = state->memory[state->sp] | (state->memory[state->sp + 1] << 8);
+		state->sp += 2;
+	}
+}
+
+template<> inline void op<0xE9>(state_8080 *state, uint8_t *opcode){
+	// PCHL
+	state->pc = (state->h << 8) | (state->l);
+}
+
+template<> inline void op<0xEA>(state_8080 *state, uint8_t *opcode){
+	// JPE
+	if(flags(state).p != 0){
+		state->pc = (opcode[2] << 8) | opcode[1];
+	}
+	else{
+		state->pc += 2;
+	}
+}
+
+template<> inline void op<0xEB>(state_8080 *state, uint8_t *opcode){
+	// XCHG
+	uint8_t temp = state->d;
+	state->d = state->h;
+	state->h = temp;
+	temp = state->e;
+	state->e = state->l;
+	state->l = temp;
+}
+
+template<> inline void op<0xEC>(state_8080 *state, uint8_t *opcode){
+	// CPE addr
+	if(flags(state).p != 0){
+		uint16_t offset = (opcode[2] << 8) | opcode[1];
+		uint16_t ret = state->pc + 2;
+		write_ram(state, state->sp-1, (ret >> 8) & 0xff);
+		write_ram(state, state->sp-2, ret & 0xff);
+		state->sp = state->sp - 2;
+		state->pc = offset;
+	}
+	else{
+		state->pc += 2;
+	}
+}
+
+template<> inline void op<0xED>(state_8080 *state, uint8_t *opcode){
+	// undocumented NOP
+}
+
+template<> inline void op<0xEF>(state_8080 *state, uint8_t *opcode){
+	// RST 5
+	uint16_t ret = state->pc;
+	write_ram(state, state->sp-1, (ret >> 8) & 0xff);
+	write_ram(state, state->sp-2, ret & 0xff);
+	state->sp = state->sp - 2;
+	state->pc = 0x28;
+}
+
+template<> inline void op<0xF0>(state_8080 *state, uint8_t *opcode){
+	// RP
+	if(flag_s(state) == 0){
+		state->pc = state->memory[state->sp] | (state->memory[state->sp + 1] << 8);
+		state->sp += 2;
+	}
+}
+
+template<> inline void op<0xF1>(state_8080 *state, uint8_t *opcode){
+	// POP PSW
+	pop(state, &state->a, &flags(state).psw);
+}
+
+template<> inline void op<0xF2>(state_8080 *state, uint8_t *opcode){
+	// JP addr
+	if(flag_s(state) == 0){
+		state->pc = (opcode[2] << 8) | opcode[1];
+	}
+	else{
+		state->pc += 2;
+	}
+}
+
+template<> inline void op<0xF3>(state_8080 *state, uint8_t *opcode){
+	// DI
+	state->int_enable = 0;
+}
+
+template<> inline void op<0xF4>(state_8080 *state, uint8_t *opcode){
+	// CP
+	if(flag_s(state) == 0){
+		uint16_t offset = (opcode[2] << 8) | opcode[1];
+		uint16_t ret = state->pc + 2;
+		write_ram(state, state->sp-1, (ret >> 8) & 0xff);
+		write_ram(state, state->sp-2, ret & 0xff);
+		state->sp = state->sp - 2;
+		state->pc = offset;
+	}
+	else{
+		state->pc += 2;
+	}
+}
+
+template<> inline void op<0xF5>(state_8080 *state, uint8_t *opcode){
+	// PUSH PSW
+	push(state, state->a, (flags(state).psw & 0xd7) | 0x02);
+}
+
+template<> inline void op<0xF7>(state_8080 *state, uint8_t *opcode){
+	// RST 6
+	uint16_t ret = state->pc;
+	write_ram(state, state->sp-1, (ret >> 8) & 0xff);
+	write_ram(state, state->sp-2, ret & 0xff);
+	state->sp = state->sp - 2;
+	state->pc = 0x30;
+}
+
+template<> inline void op<0xF8>(state_8080 *state, uint8_t *opcode){
+	// RM
+	if(flag_s(state) != 0){
+		state->pc = state->memory[state->sp] | (state->memory[state->sp + 1] << 8);
+		state->sp += 2;
+	}
+}
+
+template<> inline void op<0xF9>(state_8080 *state, uint8_t *opcode){
+	// SPHL
+	state->sp = state->l | (state->h << 8);
+}
+
+template<> inline void op<0xFA>(state_8080 *state, uint8_t *opcode){
+	// JM
+	if(flag_s(state) != 0){
+		uint16_t offset = (opcode[2] << 8) | opcode[1];
+		state->pc = offset;
+	}
+	else{
+		state->pc += 2;
+	}
+}
+
+template<> inline void op<0xFB>(state_8080 *state, uint8_t *opcode){
+	// EI
+	state->int_enable = 1;
+}
+
+template<> inline void op<0xFC>(state_8080 *state, uint8_t *opcode){
+	// CM d16
+	if(flag_s(state) != 0){
+		uint16_t offset = (opcode[2] << 8) | opcode[1];
+		uint16_t ret = state->pc + 2;
+		write_ram(state, state->sp-1, (ret >> 8) & 0xff);
+		write_ram(state, state->sp-2, ret & 0xff);
+		state->sp = state->sp - 2;
+		state->pc = offset;
+	}
+	else{
+		state->pc += 2;
+	}
+}
+
+template<> inline void op<0xFD>(state_8080 *state, uint8_t *opcode){
+	// undocumented NOP
+}
+
+template<> inline void op<0xFF>(state_8080 *state, uint8_t *opcode){
+	// RST 7
+	uint16_t ret = state->pc;
+	write_ram(state, state->sp-1, (ret >> 8) & 0xff);
+	write_ram(state, state->sp-2, ret & 0xff);
+	state->sp = state->sp - 2;
+	state->pc = 0x38;
+}
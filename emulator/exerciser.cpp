@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include "emulator.h"
+#include "block_cache.h"
+#include "jit.h"
+#include "trace.h"
+#include "CPMMachine.hpp"
+
+/*
+	Runs CPU test programs for CP/M (CPUDIAG, TST8080, 8080PRE, 8080EXER, ...) headless, as a
+	correctness oracle and a benchmark for the cores.
+
+	The program is loaded at 0100 in flat 64K memory by cpm_load_program (CPMMachine.hpp), the
+	same CP/M setup as the cpm driver. Only the BDOS console calls are emulated:
+	the BDOS entry at 0005 jumps to an OUT instruction at CPM_BDOS_TRAP, and address 0000 (warm boot)
+	holds another OUT. The cores already return to the host on OUT, so the traps cost nothing
+	per instruction and work the same for every core.
+
+	The run passes if the program returns to CP/M and prints neither "ERROR" nor "FAIL" (CPUDIAG
+	prints "CPU HAS FAILED", the exercisers "ERROR" on a CRC mismatch), and prints the -expect
+	text if one is given.
+
+	-trace keeps the last instructions in a file for tracedump, to see what led to a failure. It
+	runs the op core or the instrumented build of the run core, the block cores don't trace.
+
+	Usage: exerciser [-core op|run|cached|jit] [-limit instructions] [-expect text] [-trace file] <program.com>
+*/
+
+#define RUN_BUDGET 1000000		// cycles per call into the run cores
+
+enum core{ CORE_OP, CORE_RUN, CORE_CACHED, CORE_JIT };
+
+/**
+	Handles a BDOS call. Only the console output functions are emulated.
+	@param state: the CPU state, with the function in C
+	@param output: console output, appended to
+	@return 0 if the program asked for a warm boot
+*/
+static uint8_t bdos(state_8080 *state, std::string &output){
+	switch(state->c){
+		case 0:
+			// system reset
+			return 0;
+
+		case 2:
+			// console output
+			output += (char)state->e;
+			putchar(state->e);
+			break;
+
+		case 9:{
+			// print string
+			std::string s = cpm_string(state->memory, (state->d << 8) | state->e);
+			output += s;
+			fwrite(s.data(), 1, s.size(), stdout);
+			break;
+		}
+
+		default:
+			printf("\nunsupported BDOS call %d at %04x\n", state->c, state->pc);
+			return 0;
+	}
+	fflush(stdout);
+	return 1;
+}
+
+int main(int argc, char **argv){
+	enum core core = CORE_JIT;
+	uint64_t limit = 0;
+	const char *expect = NULL;
+	const char *trace_path = NULL;
+	const char *path = NULL;
+
+	for(int i = 1; i < argc; i++){
+		if(strcmp(argv[i], "-core") == 0 && i + 1 < argc){
+			i++;
+			if(strcmp(argv[i], "op") == 0){
+				core = CORE_OP;
+			}
+			else if(strcmp(argv[i], "run") == 0){
+				core = CORE_RUN;
+			}
+			else if(strcmp(argv[i], "cached") == 0){
+				core = CORE_CACHED;
+			}
+			else if(strcmp(argv[i], "jit") == 0){
+				core = CORE_JIT;
+			}
+			else{
+				printf("ERROR: unknown core %s\n", argv[i]);
+				return 1;
+			}
+		}
+		else if(strcmp(argv[i], "-limit") == 0 && i + 1 < argc){
+			limit = strtoull(argv[++i], NULL, 10);
+		}
+		else if(strcmp(argv[i], "-expect") == 0 && i + 1 < argc){
+			expect = argv[++i];
+		}
+		else if(strcmp(argv[i], "-trace") == 0 && i + 1 < argc){
+			trace_path = argv[++i];
+		}
+		else{
+			path = argv[i];
+		}
+	}
+	if(path == NULL){
+		printf("Usage: %s [-core op|run|cached|jit] [-limit instructions] [-expect text] [-trace file] <program.com>\n", argv[0]);
+		return 1;
+	}
+
+	state_8080 *state = (state_8080*)calloc(sizeof(state_8080), 1);
+	state->memory = (uint8_t*)calloc(0x10000, 1);
+	state->flat_memory = 1;
+	if(trace_path != NULL){
+		state->trace = trace_create(trace_path, TRACE_RECORDS);
+		if(state->trace == NULL){
+			return 1;
+		}
+		if(core != CORE_OP){
+			core = CORE_RUN;
+		}
+	}
+	if(core == CORE_CACHED || core == CORE_JIT){
+		state->cache = block_cache_create();
+	}
+	if(core == CORE_JIT){
+		state->jit = jit_create(JIT_CODE_SIZE);	// falls back to the block cache if NULL
+	}
+	if(!cpm_load_program(state, path)){
+		printf("ERROR: couldn't open %s\n", path);
+		return 1;
+	}
+
+	std::string output;
+	uint8_t booted = 0;	// 1 when the program returned to CP/M
+	auto start = std::chrono::steady_clock::now();
+
+	while(limit == 0 || state->instructions < limit){
+		uint8_t *op = state->memory + state->pc;
+		if(*op == 0xd3 || *op == 0xdb){
+			// the traps, other ports are not connected
+			if(state->trace != NULL){
+				materialize_flags(state);
+				trace_add(state->trace, state, state->pc, state->cycles);
+			}
+			state->instructions++;
+			state->cycles += cycles8080[*op];
+			if(*op == 0xd3 && state->pc == 0x0000){
+				booted = 1;
+				break;
+			}
+			if(*op == 0xd3 && state->pc == CPM_BDOS_TRAP && !bdos(state, output)){
+				booted = 1;
+				break;
+			}
+			if(*op == 0xdb){
+				state->a = 0;
+			}
+			state->pc += 2;
+			continue;
+		}
+
+		switch(core){
+			case CORE_OP:
+				state->cycles += emulate_8080_op(state);
+				break;
+			case CORE_RUN:
+				state->cycles += state->trace != NULL ? emulate_8080_run_stats(state, RUN_BUDGET) : emulate_8080_run(state, RUN_BUDGET);
+				break;
+			case CORE_CACHED:
+				state->cycles += emulate_8080_run_cached(state, RUN_BUDGET);
+				break;
+			case CORE_JIT:
+				state->cycles += emulate_8080_run_jit(state, RUN_BUDGET);
+				break;
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	uint8_t passed = booted && output.find("ERROR") == std::string::npos && output.find("FAIL") == std::string::npos &&
+					 (expect == NULL || output.find(expect) != std::string::npos);
+
+	printf("\n%s: %s, %llu instructions, %llu cycles, %.3f s, %.2f M instructions/s\n", path,
+			passed ? "PASS" : (booted ? "FAIL" : "FAIL (no warm boot)"),
+			(unsigned long long)state->instructions, (unsigned long long)state->cycles, seconds,
+			state->instructions / seconds / 1e6);
+
+	if(state->trace != NULL){
+		trace_destroy(state->trace);
+	}
+	if(state->jit != NULL){
+		jit_destroy(state->jit);
+	}
+	if(state->cache != NULL){
+		block_cache_destroy(state->cache);
+	}
+	free(state->memory);
+	free(state);
+
+	return passed ? 0 : 1;
+}
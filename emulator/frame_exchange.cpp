@@ -0,0 +1,56 @@
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include "frame_exchange.h"
+
+/**
+	Starts with a blank frame to take and every column dirty, so the consumer converts the whole
+	screen until it is known to have taken a frame.
+	@param x: the exchange
+*/
+void frame_exchange_init(frame_exchange *x){
+	memset(x->slots, 0, sizeof(x->slots));
+	memset(x->slots[1].dirty, 0xff, sizeof(x->slots[1].dirty));
+	memset(x->carry, 0xff, sizeof(x->carry));
+	x->front = 0;
+	x->middle.store(1 | FRAME_FRESH, std::memory_order_relaxed);	// a blank screen
+	x->back = 2;
+	x->number = 0;
+}
+
+/**
+	Copies the screen to the back slot and publishes it. Called by the emulation thread at vblank.
+	@param x: the exchange
+	@param vram: Space Invaders screen memory map
+	@param dirty: VRAM_COLUMNS bits, 1 for the columns written since the previous frame
+*/
+void frame_exchange_put(frame_exchange *x, const uint8_t *vram, const uint32_t *dirty){
+	frame *f = &x->slots[x->back];
+	memcpy(f->vram, vram, sizeof(f->vram));
+	for(uint32_t i = 0; i < VRAM_COLUMNS / 32; i++){
+		f->dirty[i] = dirty[i] | x->carry[i];
+	}
+	f->number = ++x->number;
+
+	// release the frame, acquire the slot the consumer gave back
+	uint32_t old = x->middle.exchange(x->back | FRAME_FRESH, std::memory_order_acq_rel);
+	x->back = old & 3;
+	for(uint32_t i = 0; i < VRAM_COLUMNS / 32; i++){
+		// previous frame taken: the consumer only lacks this one. Skipped: it still lacks both
+		x->carry[i] = (old & FRAME_FRESH) ? x->carry[i] | dirty[i] : dirty[i];
+	}
+}
+
+/**
+	Takes the latest frame. Called by the render thread.
+	@param x: the exchange
+	@return the frame, valid until the next call, NULL if none was put since the last one taken
+*/
+const frame *frame_exchange_take(frame_exchange *x){
+	if(!(x->middle.load(std::memory_order_relaxed) & FRAME_FRESH)){
+		return NULL;
+	}
+	// only the consumer clears FRAME_FRESH, so the middle slot is still fresh here
+	x->front = x->middle.exchange(x->front, std::memory_order_acq_rel) & 3;
+	return &x->slots[x->front];
+}
@@ -0,0 +1,56 @@
+#include <stdint.h>
+#include <atomic>
+#include "emulator.h"
+
+#pragma once
+
+// set in frame_exchange.middle while the frame there hasn't been taken
+#define FRAME_FRESH 4
+
+/**
+	Copy of the screen at a vblank.
+*/
+typedef struct frame{
+	uint8_t vram[VRAM_END - VRAM_START];
+	uint32_t dirty[VRAM_COLUMNS / 32];	// columns written since the frame the consumer took before this one, or more
+	uint64_t number;					// frames put so far, this one included
+} frame;
+
+/**
+	Lock-free triple buffer handing frames from the emulation thread to a render thread. The
+	producer fills the back slot and swaps it with the middle one, the consumer swaps its front
+	slot with the middle one when a fresh frame is there. Neither side ever waits: a slow consumer
+	only sees the latest frame, and the columns of the frames it skipped are carried over. Until
+	the producer learns a frame was taken its columns go with the next ones too, so the dirty
+	columns are a superset, never less.
+*/
+typedef struct frame_exchange{
+	frame slots[3];
+	std::atomic<uint32_t> middle;			// slot between the threads, | FRAME_FRESH until taken
+	uint32_t back;							// slot the producer fills
+	uint32_t front;							// slot the consumer reads
+	uint32_t carry[VRAM_COLUMNS / 32];		// columns written since the last frame known taken (producer only)
+	uint64_t number;						// frames put (producer only)
+} frame_exchange;
+
+/**
+	Starts with a blank frame to take and every column dirty, so the consumer converts the whole
+	screen until it is known to have taken a frame.
+	@param x: the exchange
+*/
+void frame_exchange_init(frame_exchange *x);
+
+/**
+	Copies the screen to the back slot and publishes it. Called by the emulation thread at vblank.
+	@param x: the exchange
+	@param vram: Space Invaders screen memory map
+	@param dirty: VRAM_COLUMNS bits, 1 for the columns written since the previous frame
+*/
+void frame_exchange_put(frame_exchange *x, const uint8_t *vram, const uint32_t *dirty);
+
+/**
+	Takes the latest frame. Called by the render thread.
+	@param x: the exchange
+	@return the frame, valid until the next call, NULL if none was put since the last one taken
+*/
+const frame *frame_exchange_take(frame_exchange *x);
@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "emulator.h"
+#include "emulator_ops.h"
+#include "block_cache.h"
+#include "fusion.h"
+
+/*
+	Fused handlers. They are called like a single instruction (state->pc past the first opcode,
+	opcode pointing at the bytes of the whole sequence) and move PC past every opcode in turn,
+	so each op<> handler sees the state it would see on its own.
+*/
+
+template<uint8_t A, uint8_t B> static void fused_pair(state_8080 *state, uint8_t *opcode){
+	static_assert(fusion_can_lead(A) && fusion_can_end(B), "invalid fused pair");
+	op<A>(state, opcode);
+	opcode += lengths8080[A];
+	state->pc += 1;
+	op<B>(state, opcode);
+}
+
+template<uint8_t A, uint8_t B, uint8_t C> static void fused_triple(state_8080 *state, uint8_t *opcode){
+	static_assert(fusion_can_lead(A) && fusion_can_lead(B) && fusion_can_end(C), "invalid fused triple");
+	op<A>(state, opcode);
+	opcode += lengths8080[A];
+	state->pc += 1;
+	op<B>(state, opcode);
+	opcode += lengths8080[B];
+	state->pc += 1;
+	op<C>(state, opcode);
+}
+
+/**
+	An entry of FUSION_LIST.
+*/
+typedef struct fused_sequence{
+	uint8_t count;
+	uint8_t opcodes[3];
+	op_handler handler;
+} fused_sequence;
+
+#define FUSED_PAIR_ENTRY(a, b) { 2, { a, b, 0 }, fused_pair<a, b> },
+#define FUSED_TRIPLE_ENTRY(a, b, c) { 3, { a, b, c }, fused_triple<a, b, c> },
+
+static const fused_sequence sequences[] = { FUSION_LIST(FUSED_PAIR_ENTRY, FUSED_TRIPLE_ENTRY) };
+
+/**
+	Decodes the fused sequence starting at addr, if FUSION_LIST has one.
+	@param memory: the 8080 memory
+	@param addr: address of the first instruction
+	@param op: filled with the fused sequence on a match
+	@return the number of instructions fused, 0 if there is no sequence at addr
+*/
+uint8_t fusion_decode(uint8_t *memory, uint16_t addr, decoded_op *op){
+	const fused_sequence *best = NULL;
+	uint8_t length = 0;
+
+	for(uint32_t i = 0; i < sizeof(sequences) / sizeof(sequences[0]); i++){
+		const fused_sequence *seq = &sequences[i];
+		uint16_t next = addr;
+		uint8_t j;
+		for(j = 0; j < seq->count && memory[next] == seq->opcodes[j]; j++){
+			next += lengths8080[seq->opcodes[j]];
+		}
+		// the longest match wins
+		if(j == seq->count && (uint16_t)(next - addr) <= FUSED_MAX_BYTES && (best == NULL || seq->count > best->count)){
+			best = seq;
+			length = next - addr;
+		}
+	}
+	if(best == NULL){
+		return 0;
+	}
+
+	op->handler = best->handler;
+	op->pc = addr;
+	op->cycles = 0;
+	op->writes = 0;
+	op->count = best->count;
+	for(uint8_t i = 0; i < length; i++){
+		op->bytes[i] = memory[(uint16_t)(addr + i)];
+	}
+	for(uint8_t i = 0; i < best->count; i++){
+		op->cycles += cycles8080[best->opcodes[i]];
+		op->writes |= op_writes_memory(best->opcodes[i]);
+	}
+	return best->count;
+}
+
+/**
+	Splits a decoded fused sequence back into its instructions.
+	@param op: decoded instruction or fused sequence
+	@param subs: filled with op->count single instructions
+*/
+void fusion_split(const decoded_op *op, decoded_op *subs){
+	uint8_t offset = 0;
+
+	if(op->count == 1){
+		subs[0] = *op;
+		return;
+	}
+	for(uint8_t i = 0; i < op->count; i++){
+		uint8_t opcode = op->bytes[offset];
+		decoded_op *sub = &subs[i];
+		sub->handler = get_op_handler(opcode);
+		sub->pc = op->pc + offset;
+		memset(sub->bytes, 0, sizeof(sub->bytes));
+		memcpy(sub->bytes, op->bytes + offset, lengths8080[opcode]);
+		sub->cycles = cycles8080[opcode];
+		sub->writes = op_writes_memory(opcode);
+		sub->count = 1;
+		offset += lengths8080[opcode];
+	}
+}
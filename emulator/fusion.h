@@ -0,0 +1,58 @@
+#include <stdint.h>
+#include "emulator.h"
+#include "block_cache.h"
+
+#pragma once
+
+/*
+	Opcode sequences the block decoder runs as a single fused handler, with the cycles of all their
+	instructions. Picked from the output of fusion_miner (see the Makefile), most executed first.
+	Every instruction but the last one must not end a block or write memory, none can be IN, OUT or
+	EI, and a sequence is at most FUSED_MAX_BYTES long.
+*/
+#define FUSION_LIST(PAIR, TRIPLE) \
+	PAIR(0x05, 0xc2)			/* DCR B; JNZ */ \
+	PAIR(0x7e, 0xa7)			/* MOV A,M; ANA A */ \
+	PAIR(0x0c, 0x23)			/* INR C; INX H */ \
+	PAIR(0xa7, 0xca)			/* ANA A; JZ */ \
+	PAIR(0xa7, 0xc2)			/* ANA A; JNZ */ \
+	PAIR(0x09, 0xc1)			/* DAD B; POP B */ \
+	PAIR(0x1a, 0x77)			/* LDAX D; MOV M,A */ \
+	PAIR(0x3a, 0xa7)			/* LDA; ANA A */ \
+	PAIR(0x01, 0x09)			/* LXI B; DAD B */ \
+	PAIR(0x23, 0x13)			/* INX H; INX D */ \
+	PAIR(0x3a, 0x0f)			/* LDA; RRC */ \
+	TRIPLE(0x23, 0x7e, 0xa7)	/* INX H; MOV A,M; ANA A */ \
+	TRIPLE(0x7e, 0xfe, 0xc8)	/* MOV A,M; CPI; RZ */
+
+/**
+	@param opcode: instruction opcode
+	@return 1 if the instruction can be followed by another one in a fused sequence
+*/
+static inline constexpr uint8_t fusion_can_lead(uint8_t opcode){
+	return !op_ends_block(opcode) && !op_writes_memory(opcode) && opcode != 0xdb && opcode != 0xd3 && opcode != 0xfb;
+}
+
+/**
+	@param opcode: instruction opcode
+	@return 1 if the instruction can end a fused sequence
+*/
+static inline constexpr uint8_t fusion_can_end(uint8_t opcode){
+	return opcode != 0xdb && opcode != 0xd3 && opcode != 0xfb;
+}
+
+/**
+	Decodes the fused sequence starting at addr, if FUSION_LIST has one.
+	@param memory: the 8080 memory
+	@param addr: address of the first instruction
+	@param op: filled with the fused sequence on a match
+	@return the number of instructions fused, 0 if there is no sequence at addr
+*/
+uint8_t fusion_decode(uint8_t *memory, uint16_t addr, decoded_op *op);
+
+/**
+	Splits a decoded fused sequence back into its instructions.
+	@param op: decoded instruction or fused sequence
+	@param subs: filled with op->count single instructions
+*/
+void fusion_split(const decoded_op *op, decoded_op *subs);
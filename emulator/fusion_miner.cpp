@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+#include "emulator.h"
+#include "fusion.h"
+#include "SIMachine.hpp"
+#include "Display.hpp"
+#include "opcode_stats.h"
+#include "trace.h"
+#include "player.h"
+
+/*
+	Finds candidate sequences for FUSION_LIST (fusion.h).
+
+	Runs the ROM on SIMachine with a null display and the scripted player (player.h), so the
+	instruction stream is the one the emulator runs, interrupts and I/O included. Pairs come from
+	the opcode counters of the instrumented core, triples from an in-memory trace scanned after
+	every frame. Prints the most executed sequences that could be fused, ready to paste into
+	FUSION_LIST. Runs from the emulator directory, the ROM path is relative.
+
+	Usage: fusion_miner [frames] [top]
+*/
+
+// instructions kept between two scans, a frame runs about 4000
+#define MINER_TRACE_RECORDS (1 << 16)
+
+/**
+	A candidate sequence and how many times it ran.
+*/
+typedef struct candidate{
+	uint8_t count;
+	uint8_t opcodes[3];
+	uint64_t executed;
+} candidate;
+
+/**
+	@param a: first instruction
+	@param b: instruction executed after it
+	@return 1 if the two are a sequence that could be fused
+*/
+static uint8_t fusable(uint8_t a, uint8_t b){
+	return fusion_can_lead(a) && fusion_can_end(b) && lengths8080[a] + lengths8080[b] <= FUSED_MAX_BYTES;
+}
+
+/**
+	@param r: a traced instruction
+	@param next: the record after it
+	@return 1 if next is the instruction right after r in memory, with no jump or interrupt between
+*/
+static uint8_t falls_through(const trace_record *r, const trace_record *next){
+	return (uint16_t)(r->pc + lengths8080[r->op[0]]) == next->pc;
+}
+
+int main(int argc, char **argv){
+	uint64_t frames = argc > 1 ? strtoull(argv[1], NULL, 10) : 3600;
+	uint32_t top = argc > 2 ? atoi(argv[2]) : 20;
+
+	NullDisplay display;
+	SIMachine machine(&display);
+	machine.count_opcodes();
+	if(!machine.trace_to(NULL, MINER_TRACE_RECORDS)){
+		return 1;
+	}
+	trace *t = machine.state->trace;
+	std::unordered_map<uint32_t, uint64_t> triple_counts;	// keyed by the three opcodes
+
+	uint64_t scanned = 0;
+	for(uint64_t frame = 0; frame < frames; frame++){
+		machine.in_port1 = player_input(frame);
+		machine.run_until((frame + 1) * CPU_HZ / FRAME_HZ);
+
+		// lead instructions don't jump, so any other PC after them is an interrupt
+		for(uint64_t i = std::max(scanned, trace_first(t) + 2); i < t->header->count; i++){
+			const trace_record *r0 = trace_get(t, i - 2);
+			const trace_record *r1 = trace_get(t, i - 1);
+			const trace_record *r2 = trace_get(t, i);
+			if(fusable(r0->op[0], r1->op[0]) && fusable(r1->op[0], r2->op[0]) && falls_through(r0, r1) &&
+			   falls_through(r1, r2) &&
+			   lengths8080[r0->op[0]] + lengths8080[r1->op[0]] + lengths8080[r2->op[0]] <= FUSED_MAX_BYTES){
+				triple_counts[(r0->op[0] << 16) | (r1->op[0] << 8) | r2->op[0]]++;
+			}
+		}
+		scanned = t->header->count;
+	}
+	uint64_t instructions = machine.state->instructions;
+
+	std::vector<candidate> candidates;
+	const opcode_stats *stats = machine.state->stats;
+	for(int a = 0; a < 256; a++){
+		for(int b = 0; b < 256; b++){
+			if(stats->pairs[a][b] && fusable(a, b)){
+				candidates.push_back({ 2, { (uint8_t)a, (uint8_t)b, 0 }, stats->pairs[a][b] });
+			}
+		}
+	}
+	for(auto &t : triple_counts){
+		candidates.push_back({ 3, { (uint8_t)(t.first >> 16), (uint8_t)(t.first >> 8), (uint8_t)t.first }, t.second });
+	}
+	// rank by dispatches saved
+	std::sort(candidates.begin(), candidates.end(), [](const candidate &x, const candidate &y){
+		return x.executed * (x.count - 1) > y.executed * (y.count - 1);
+	});
+
+	printf("%llu instructions in %llu frames\n", (unsigned long long)instructions, (unsigned long long)frames);
+	for(uint32_t i = 0; i < top && i < candidates.size(); i++){
+		candidate *c = &candidates[i];
+		double saved = 100.0 * c->executed * (c->count - 1) / instructions;
+		if(c->count == 2){
+			printf("\tPAIR(0x%02x, 0x%02x)\t\t/* %llu runs, %.2f%% dispatches saved */ \\\n",
+					c->opcodes[0], c->opcodes[1], (unsigned long long)c->executed, saved);
+		}
+		else{
+			printf("\tTRIPLE(0x%02x, 0x%02x, 0x%02x)\t/* %llu runs, %.2f%% dispatches saved */ \\\n",
+					c->opcodes[0], c->opcodes[1], c->opcodes[2], (unsigned long long)c->executed, saved);
+		}
+	}
+
+	return 0;
+}
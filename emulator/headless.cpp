@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "emulator.h"
+#include "SIMachine.hpp"
+#include "Display.hpp"
+#include "opcode_stats.h"
+#include "pc_profile.h"
+#include "callgraph.h"
+#include "trace.h"
+
+/*
+	Runs the machine without a window or input, as fast as the host allows, and prints a hash of
+	the RAM at the end so runs can be compared. Needs no SDL.
+
+	With --opcode-stats it runs the instrumented core and writes the opcode counters to file, with
+	--pc-profile it samples PC and writes folded stacks to file, with --call-graph it follows CALL
+	and RET and writes the cycles per call stack to file, with --trace it keeps the last
+	instructions in file for tracedump.
+
+	Usage: headless [frames] [--opcode-stats file] [--pc-profile file [--sample-interval cycles]]
+					[--call-graph file] [--symbols map] [--trace file [--trace-records n]]
+*/
+
+int main(int argc, char **argv){
+	uint64_t frames = 3600;
+	const char *stats_path = NULL;
+	const char *profile_path = NULL;
+	const char *calls_path = NULL;
+	const char *symbols_path = NULL;
+	const char *trace_path = NULL;
+	uint32_t trace_records = TRACE_RECORDS;
+	uint32_t interval = PC_PROFILE_INTERVAL;
+
+	NullDisplay display;
+	SIMachine machine(&display);
+
+	for(int i = 1; i < argc; i++){
+		if(strcmp(argv[i], "--opcode-stats") == 0 && i + 1 < argc){
+			stats_path = argv[++i];
+			machine.count_opcodes();
+		}
+		else if(strcmp(argv[i], "--pc-profile") == 0 && i + 1 < argc){
+			// sample PC, folded stacks on exit
+			profile_path = argv[++i];
+		}
+		else if(strcmp(argv[i], "--call-graph") == 0 && i + 1 < argc){
+			// follow CALL and RET, call graph on exit
+			calls_path = argv[++i];
+			machine.profile_calls();
+		}
+		else if(strcmp(argv[i], "--trace") == 0 && i + 1 < argc){
+			// last instructions in a file, read with tracedump
+			trace_path = argv[++i];
+		}
+		else if(strcmp(argv[i], "--trace-records") == 0 && i + 1 < argc){
+			trace_records = strtoul(argv[++i], NULL, 10);
+		}
+		else if(strcmp(argv[i], "--symbols") == 0 && i + 1 < argc){
+			symbols_path = argv[++i];
+		}
+		else if(strcmp(argv[i], "--sample-interval") == 0 && i + 1 < argc){
+			interval = strtoul(argv[++i], NULL, 10);
+		}
+		else{
+			frames = strtoull(argv[i], NULL, 10);
+		}
+	}
+	if(profile_path != NULL){
+		if(interval == 0){
+			printf("--sample-interval needs a number of cycles above 0\n");
+			return 1;
+		}
+		machine.profile_pc(interval);
+	}
+	if(trace_path != NULL && !machine.trace_to(trace_path, trace_records)){
+		return 1;
+	}
+
+	machine.run_until(frames * CPU_HZ / FRAME_HZ);
+
+	// FNV-1a over the RAM
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for(uint32_t i = 0x2000; i < 0x4000; i++){
+		hash = (hash ^ machine.state->memory[i]) * 0x100000001b3ULL;
+	}
+	printf("frames %llu cycles %llu instructions %llu ram %016llx\n", (unsigned long long)display.frames,
+			(unsigned long long)machine.state->cycles, (unsigned long long)machine.state->instructions,
+			(unsigned long long)hash);
+
+	if(stats_path != NULL){
+		opcode_stats_dump(machine.state->stats, stats_path);
+	}
+	if(profile_path != NULL){
+		pc_profile_dump(machine.profile, symbols_path, profile_path);
+	}
+	if(calls_path != NULL){
+		callgraph_dump(machine.state->calls, symbols_path, calls_path);
+	}
+
+	return 0;
+}
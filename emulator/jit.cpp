@@ -0,0 +1,651 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "emulator.h"
+#include "block_cache.h"
+#include "fusion.h"
+#include "jit.h"
+
+// LAZY_FLAGS builds keep pending flags in the CPU state, so native code can't write the PSW directly
+#ifndef LAZY_FLAGS
+#define LAZY_FLAGS 0
+#endif
+
+/*
+	Generated code layout (System V ABI, int32_t block(state_8080 *state)):
+
+	rbx			the CPU state
+	r15			state->memory
+	ebp			block cache generation when the block was entered
+	r8d..r14d	8080 registers A B C D E H L, zero extended, loaded on first use
+	rax rcx rdx	scratch
+
+	Registers are written back to the state before every handler call and at the end of the block,
+	and reloaded on their next use after a call. The block returns the cycles it executed.
+*/
+
+enum host_reg{ RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+// host register of every 8080 register, by register encoding (B C D E H L M A)
+static const uint8_t host_regs[8] = { R9, R10, R11, R12, R13, R14, 0, R8 };
+
+// 8080 ALU operations, in opcode order
+enum alu_op{ ALU_ADD, ALU_ADC, ALU_SUB, ALU_SBB, ALU_ANA, ALU_XRA, ALU_ORA, ALU_CMP };
+
+// x86 ALU opcodes ("op r/m8, r8" form), by 8080 ALU operation (ADD ADC SUB SBB ANA XRA ORA CMP)
+static const uint8_t x86_alu_ops[8] = { 0x00, 0x10, 0x28, 0x18, 0x20, 0x30, 0x08, 0x38 };
+
+/**
+	Code buffer being written.
+*/
+typedef struct emitter{
+	uint8_t *p;
+	uint8_t *end;
+	uint8_t overflow;
+
+	uint8_t loaded;		// bitmask of 8080 registers present in their host register
+	uint8_t dirty;		// bitmask of 8080 registers modified since they were loaded
+} emitter;
+
+static void emit8(emitter *e, uint8_t b){
+	if(e->p < e->end){
+		*e->p++ = b;
+	}
+	else{
+		e->overflow = 1;
+	}
+}
+
+static void emit16(emitter *e, uint16_t v){
+	emit8(e, v & 0xff);
+	emit8(e, v >> 8);
+}
+
+static void emit32(emitter *e, uint32_t v){
+	emit16(e, v & 0xffff);
+	emit16(e, v >> 16);
+}
+
+static void emit64(emitter *e, uint64_t v){
+	emit32(e, v & 0xffffffff);
+	emit32(e, v >> 32);
+}
+
+/**
+	Emits a REX prefix if any of its bits is needed.
+*/
+static void emit_rex(emitter *e, uint8_t w, uint8_t reg, uint8_t index, uint8_t base){
+	uint8_t rex = 0x40 | (w << 3) | ((reg >> 3) << 2) | ((index >> 3) << 1) | (base >> 3);
+	if(rex != 0x40){
+		emit8(e, rex);
+	}
+}
+
+static void emit_modrm(emitter *e, uint8_t mod, uint8_t reg, uint8_t rm){
+	emit8(e, (mod << 6) | ((reg & 7) << 3) | (rm & 7));
+}
+
+/**
+	op reg, [base + disp32] (or op [base + disp32], reg), with up to two opcode bytes.
+*/
+static void emit_mem(emitter *e, uint8_t w, uint16_t opcode, uint8_t reg, uint8_t base, int32_t disp){
+	emit_rex(e, w, reg, 0, base);
+	if(opcode > 0xff){
+		emit8(e, opcode >> 8);
+	}
+	emit8(e, opcode & 0xff);
+	emit_modrm(e, 2, reg, base);
+	if((base & 7) == RSP){
+		emit8(e, 0x24);
+	}
+	emit32(e, disp);
+}
+
+// mov dst32, src32
+static void emit_mov_rr(emitter *e, uint8_t dst, uint8_t src){
+	emit_rex(e, 0, src, 0, dst);
+	emit8(e, 0x89);
+	emit_modrm(e, 3, src, dst);
+}
+
+// mov dst32, imm32
+static void emit_mov_ri(emitter *e, uint8_t dst, uint32_t imm){
+	emit_rex(e, 0, 0, 0, dst);
+	emit8(e, 0xb8 + (dst & 7));
+	emit32(e, imm);
+}
+
+// mov dst64, imm64
+static void emit_mov_ri64(emitter *e, uint8_t dst, uint64_t imm){
+	emit_rex(e, 1, 0, 0, dst);
+	emit8(e, 0xb8 + (dst & 7));
+	emit64(e, imm);
+}
+
+// 81 /ext dst32, imm32 (add, or, and, sub, xor, cmp)
+static void emit_alu_ri(emitter *e, uint8_t ext, uint8_t dst, uint32_t imm){
+	emit_rex(e, 0, 0, 0, dst);
+	emit8(e, 0x81);
+	emit_modrm(e, 3, ext, dst);
+	emit32(e, imm);
+}
+
+// C1 /ext dst32, imm8 (shl = 4, shr = 5)
+static void emit_shift_ri(emitter *e, uint8_t ext, uint8_t dst, uint8_t imm){
+	emit_rex(e, 0, 0, 0, dst);
+	emit8(e, 0xc1);
+	emit_modrm(e, 3, ext, dst);
+	emit8(e, imm);
+}
+
+// or dst32, src32
+static void emit_or_rr(emitter *e, uint8_t dst, uint8_t src){
+	emit_rex(e, 0, src, 0, dst);
+	emit8(e, 0x09);
+	emit_modrm(e, 3, src, dst);
+}
+
+// movzx dst32, low byte of src
+static void emit_movzx_rr8(emitter *e, uint8_t dst, uint8_t src){
+	// a REX prefix makes 4..7 mean spl..dil instead of ah..bh
+	uint8_t rex = 0x40 | ((dst >> 3) << 2) | (src >> 3);
+	if(rex != 0x40 || src >= RSP){
+		emit8(e, rex);
+	}
+	emit8(e, 0x0f);
+	emit8(e, 0xb6);
+	emit_modrm(e, 3, dst, src);
+}
+
+// movzx dst32, byte [r15 + index64]
+static void emit_load_memory(emitter *e, uint8_t dst, uint8_t index){
+	emit_rex(e, 0, dst, index, R15);
+	emit8(e, 0x0f);
+	emit8(e, 0xb6);
+	emit_modrm(e, 0, dst, 4);
+	emit8(e, ((index & 7) << 3) | (R15 & 7));
+}
+
+// movzx dst32, byte [rbx + offset]
+static void emit_load_state8(emitter *e, uint8_t dst, int32_t offset){
+	emit_mem(e, 0, 0x0fb6, dst, RBX, offset);
+}
+
+// mov byte [rbx + offset], src8
+static void emit_store_state8(emitter *e, uint8_t src, int32_t offset){
+	// a REX prefix makes 4..7 mean spl..dil instead of ah..bh
+	if(src >= RSP && src < R8){
+		emit8(e, 0x40);
+	}
+	emit_mem(e, 0, 0x88, src, RBX, offset);
+}
+
+// mov word [rbx + offset], imm16
+static void emit_store_state16_imm(emitter *e, int32_t offset, uint16_t imm){
+	emit8(e, 0x66);
+	emit_mem(e, 0, 0xc7, 0, RBX, offset);
+	emit16(e, imm);
+}
+
+/**
+	Makes sure an 8080 register is in its host register.
+*/
+static uint8_t use_reg(emitter *e, int r){
+	if(!(e->loaded & (1 << r))){
+		emit_load_state8(e, host_regs[r], offsetof(state_8080, regs) + r);
+		e->loaded |= 1 << r;
+	}
+	return host_regs[r];
+}
+
+/**
+	Returns the host register of an 8080 register that is about to be overwritten.
+*/
+static uint8_t def_reg(emitter *e, int r){
+	e->loaded |= 1 << r;
+	e->dirty |= 1 << r;
+	return host_regs[r];
+}
+
+/**
+	Writes the modified registers back to the CPU state.
+*/
+static void spill(emitter *e){
+	for(int r = 0; r < 8; r++){
+		if(e->dirty & (1 << r)){
+			emit_store_state8(e, host_regs[r], offsetof(state_8080, regs) + r);
+		}
+	}
+	e->dirty = 0;
+}
+
+/**
+	eax = (hi << 8) | lo for the register pair starting at hi.
+*/
+static void emit_pair(emitter *e, int hi){
+	emit_mov_rr(e, RAX, use_reg(e, hi));
+	emit_shift_ri(e, 4, RAX, 8);
+	emit_or_rr(e, RAX, use_reg(e, hi + 1));
+}
+
+static void emit_prologue(emitter *e, block_cache *cache){
+	emit8(e, 0x53);					// push rbx
+	emit8(e, 0x41); emit8(e, 0x54);	// push r12
+	emit8(e, 0x41); emit8(e, 0x55);	// push r13
+	emit8(e, 0x41); emit8(e, 0x56);	// push r14
+	emit8(e, 0x41); emit8(e, 0x57);	// push r15
+	emit8(e, 0x55);					// push rbp
+	emit8(e, 0x48); emit8(e, 0x83); emit8(e, 0xec); emit8(e, 0x08);	// sub rsp, 8 (keeps calls aligned)
+	emit8(e, 0x48); emit8(e, 0x89); emit8(e, 0xfb);	// mov rbx, rdi
+	emit_mem(e, 1, 0x8b, R15, RBX, offsetof(state_8080, memory));	// mov r15, [rbx + memory]
+	emit_mov_ri64(e, RAX, (uint64_t)&cache->generation);
+	emit8(e, 0x8b); emit8(e, 0x28);	// mov ebp, [rax]
+}
+
+static void emit_epilogue(emitter *e, int32_t cycles){
+	emit_mov_ri(e, RAX, cycles);
+	emit8(e, 0x48); emit8(e, 0x83); emit8(e, 0xc4); emit8(e, 0x08);	// add rsp, 8
+	emit8(e, 0x5d);					// pop rbp
+	emit8(e, 0x41); emit8(e, 0x5f);	// pop r15
+	emit8(e, 0x41); emit8(e, 0x5e);	// pop r14
+	emit8(e, 0x41); emit8(e, 0x5d);	// pop r13
+	emit8(e, 0x41); emit8(e, 0x5c);	// pop r12
+	emit8(e, 0x5b);					// pop rbx
+	emit8(e, 0xc3);					// ret
+}
+
+/**
+	Compiles an instruction as a call to its handler.
+	@param cycles: cycles executed once the instruction is done, returned if it overwrites code
+*/
+static void emit_fallback(emitter *e, block_cache *cache, decoded_op *op, int32_t cycles){
+	spill(e);
+	emit_store_state16_imm(e, offsetof(state_8080, pc), op->pc + 1);
+	emit8(e, 0x48); emit8(e, 0x89); emit8(e, 0xdf);	// mov rdi, rbx
+	emit_mov_ri64(e, RSI, (uint64_t)op->bytes);
+	emit_mov_ri64(e, RAX, (uint64_t)op->handler);
+	emit8(e, 0xff); emit8(e, 0xd0);	// call rax
+	e->loaded = 0;
+
+	if(op->writes){
+		// leave the block if it overwrote decoded code, PC is already past the instruction
+		emit_mov_ri64(e, RAX, (uint64_t)&cache->generation);
+		emit8(e, 0x39); emit8(e, 0x28);	// cmp [rax], ebp
+		emit8(e, 0x74);					// je over the exit
+		uint8_t *patch = e->p;
+		emit8(e, 0);
+		emit_epilogue(e, cycles);
+		if(!e->overflow){
+			*patch = e->p - patch - 1;
+		}
+	}
+}
+
+#if !LAZY_FLAGS
+// mov [rbx + cc], ah
+static void emit_store_psw_ah(emitter *e){
+	emit8(e, 0x88);
+	emit_modrm(e, 2, 4, RBX);
+	emit32(e, offsetof(state_8080, cc));
+}
+
+// 80 /ext ah, imm8 (or = 1, and = 4, xor = 6)
+static void emit_alu_ah(emitter *e, uint8_t ext, uint8_t imm){
+	emit8(e, 0x80);
+	emit_modrm(e, 3, ext, 4);
+	emit8(e, imm);
+}
+
+/**
+	ALU operation on the accumulator with the operand in ecx. The x86 flags after lahf have the
+	same layout as the 8080 PSW (S Z 0 AC 0 P 1 CY), only AC differs for some operations.
+*/
+static void emit_alu(emitter *e, int alu){
+	uint8_t a = use_reg(e, REG_A);
+	emit_mov_rr(e, RAX, a);
+	if(alu == ALU_ANA){
+		// 8080 AND sets AC to the OR of bit 3 of the operands
+		emit_mov_rr(e, RDX, RAX);
+		emit_or_rr(e, RDX, RCX);
+		emit_alu_ri(e, 4, RDX, 0x08);
+		emit_shift_ri(e, 4, RDX, 1);
+	}
+	if(alu == ALU_ADC || alu == ALU_SBB){
+		// bt dword [rbx + cc], 0 copies the 8080 carry into CF
+		emit_mem(e, 0, 0x0fba, 4, RBX, offsetof(state_8080, cc));
+		emit8(e, 0);
+	}
+	emit8(e, x86_alu_ops[alu]);
+	emit_modrm(e, 3, RCX, RAX);		// op al, cl
+	emit8(e, 0x9f);					// lahf
+
+	if(alu < ALU_ANA || alu == ALU_CMP){
+		emit_alu_ah(e, 4, FLAG_S | FLAG_Z | FLAG_AC | FLAG_P | 0x02 | FLAG_CY);
+		if(alu != ALU_ADD && alu != ALU_ADC){
+			// x86 sets AF on a borrow out of bit 3, the 8080 sets AC when there is none
+			emit_alu_ah(e, 6, FLAG_AC);
+		}
+	}
+	else{
+		// logical operations clear CY and AC (AF is undefined on x86)
+		emit_alu_ah(e, 4, FLAG_S | FLAG_Z | FLAG_P | 0x02);
+		if(alu == ALU_ANA){
+			emit8(e, 0x08); emit8(e, 0xd4);	// or ah, dl
+		}
+	}
+	emit_store_psw_ah(e);
+	if(alu != ALU_CMP){
+		emit_movzx_rr8(e, def_reg(e, REG_A), RAX);
+	}
+}
+
+/**
+	INR/DCR of a register. CY is kept from the PSW, AC is inverted for DCR like for subtractions.
+*/
+static void emit_inr_dcr(emitter *e, int r, uint8_t dcr){
+	emit_mov_rr(e, RAX, use_reg(e, r));
+	emit8(e, 0xfe); emit8(e, dcr ? 0xc8 : 0xc0);	// dec al / inc al
+	emit8(e, 0x9f);									// lahf
+	emit_alu_ah(e, 4, FLAG_S | FLAG_Z | FLAG_AC | FLAG_P | 0x02);
+	if(dcr){
+		emit_alu_ah(e, 6, FLAG_AC);
+	}
+	emit_load_state8(e, RDX, offsetof(state_8080, cc));
+	emit_alu_ri(e, 4, RDX, FLAG_CY);
+	emit8(e, 0x08); emit8(e, 0xd4);					// or ah, dl
+	emit_store_psw_ah(e);
+	emit_movzx_rr8(e, def_reg(e, r), RAX);
+}
+#endif
+
+/**
+	INX/DCX of the register pair starting at hi.
+*/
+static void emit_inx_dcx(emitter *e, int hi, uint8_t dcx){
+	emit_pair(e, hi);
+	emit_alu_ri(e, dcx ? 5 : 0, RAX, 1);
+	emit_movzx_rr8(e, def_reg(e, hi + 1), RAX);
+	emit_shift_ri(e, 5, RAX, 8);
+	emit_movzx_rr8(e, def_reg(e, hi), RAX);
+}
+
+/**
+	Emits native code for an instruction.
+	@return 1 if the instruction was translated, 0 if it needs its handler
+*/
+static uint8_t emit_native(emitter *e, decoded_op *op){
+	uint8_t opcode = op->bytes[0];
+	uint16_t addr16 = (op->bytes[2] << 8) | op->bytes[1];
+	int dst = (opcode >> 3) & 7;
+	int src = opcode & 7;
+
+	if((opcode & 0xc0) == 0x40 && opcode != 0x76 && dst != REG_M){
+		// MOV r, r / MOV r, M
+		if(src == REG_M){
+			emit_pair(e, REG_H);
+			emit_load_memory(e, def_reg(e, dst), RAX);
+		}
+		else if(src != dst){
+			uint8_t from = use_reg(e, src);
+			emit_mov_rr(e, def_reg(e, dst), from);
+		}
+		return 1;
+	}
+	if((opcode & 0xc7) == 0x06 && dst != REG_M){
+		// MVI r, d8
+		emit_mov_ri(e, def_reg(e, dst), op->bytes[1]);
+		return 1;
+	}
+	if((opcode & 0xcf) == 0x01){
+		// LXI rp, d16
+		if(opcode == 0x31){
+			emit_store_state16_imm(e, offsetof(state_8080, sp), addr16);
+		}
+		else{
+			int hi = (opcode >> 3) & 6;
+			emit_mov_ri(e, def_reg(e, hi), op->bytes[2]);
+			emit_mov_ri(e, def_reg(e, hi + 1), op->bytes[1]);
+		}
+		return 1;
+	}
+	if((opcode & 0xc7) == 0x03){
+		// INX rp / DCX rp
+		uint8_t dcx = (opcode & 0x08) != 0;
+		if((opcode & 0x30) == 0x30){
+			// inc/dec word [rbx + sp]
+			emit8(e, 0x66);
+			emit_mem(e, 0, 0xff, dcx, RBX, offsetof(state_8080, sp));
+		}
+		else{
+			emit_inx_dcx(e, (opcode >> 3) & 6, dcx);
+		}
+		return 1;
+	}
+
+	switch(opcode){
+		case 0x00: case 0x08: case 0x10: case 0x18:
+		case 0x20: case 0x28: case 0x30: case 0x38:
+		case 0xd9: case 0xdd: case 0xed: case 0xfd:
+			// NOP and the undocumented NOPs
+			return 1;
+		case 0x0a: case 0x1a:
+			// LDAX B / LDAX D
+			emit_pair(e, opcode == 0x0a ? REG_B : REG_D);
+			emit_load_memory(e, def_reg(e, REG_A), RAX);
+			return 1;
+		case 0x3a:
+			// LDA addr
+			emit_mov_ri(e, RAX, addr16);
+			emit_load_memory(e, def_reg(e, REG_A), RAX);
+			return 1;
+		case 0x2f:
+			// CMA
+			emit_alu_ri(e, 6, use_reg(e, REG_A), 0xff);
+			def_reg(e, REG_A);
+			return 1;
+		case 0xeb:
+			// XCHG
+			{
+				uint8_t d = use_reg(e, REG_D);
+				uint8_t h = use_reg(e, REG_H);
+				uint8_t el = use_reg(e, REG_E);
+				uint8_t l = use_reg(e, REG_L);
+				emit_rex(e, 0, d, 0, h);
+				emit8(e, 0x87);
+				emit_modrm(e, 3, d, h);
+				emit_rex(e, 0, el, 0, l);
+				emit8(e, 0x87);
+				emit_modrm(e, 3, el, l);
+				e->dirty |= (1 << REG_D) | (1 << REG_E) | (1 << REG_H) | (1 << REG_L);
+			}
+			return 1;
+	}
+
+#if !LAZY_FLAGS
+	if(opcode == 0x37 || opcode == 0x3f){
+		// STC / CMC: or/xor byte [rbx + cc], 1
+		emit_mem(e, 0, 0x80, opcode == 0x37 ? 1 : 6, RBX, offsetof(state_8080, cc));
+		emit8(e, FLAG_CY);
+		return 1;
+	}
+	if((opcode & 0xc0) == 0x80 || (opcode & 0xc7) == 0xc6){
+		// ALU r / ALU M / ALU d8
+		if((opcode & 0xc0) == 0xc0){
+			emit_mov_ri(e, RCX, op->bytes[1]);
+		}
+		else if(src == REG_M){
+			emit_pair(e, REG_H);
+			emit_load_memory(e, RCX, RAX);
+		}
+		else{
+			emit_mov_rr(e, RCX, use_reg(e, src));
+		}
+		emit_alu(e, dst);
+		return 1;
+	}
+	if(((opcode & 0xc7) == 0x04 || (opcode & 0xc7) == 0x05) && dst != REG_M){
+		// INR r / DCR r
+		emit_inr_dcr(e, dst, opcode & 1);
+		return 1;
+	}
+#endif
+
+	return 0;
+}
+
+/**
+	Compiles a block at the current end of the code region.
+	@return the native code, or NULL if the region is full
+*/
+static void *compile_block(jit *j, block_cache *cache, block *b){
+	emitter e = { j->code + j->used, j->code + j->size, 0, 0, 0 };
+	uint8_t *start = e.p;
+	int32_t cycles = 0;
+	uint8_t last_native = 0;
+	uint16_t end_pc = 0;
+	uint64_t native_ops = 0;
+	uint64_t instructions = 0;
+
+	emit_prologue(&e, cache);
+	for(uint16_t i = 0; i < b->count; i++){
+		decoded_op *op = &b->ops[i];
+		decoded_op subs[3];
+		emitter before = e;
+
+		// fused sequences are compiled instruction by instruction, or as one call to the fused handler
+		fusion_split(op, subs);
+		last_native = 1;
+		for(uint8_t k = 0; k < op->count && last_native; k++){
+			last_native = emit_native(&e, &subs[k]);
+		}
+		cycles += op->cycles;
+		instructions += op->count;
+		if(last_native){
+			native_ops += op->count;
+			end_pc = subs[op->count - 1].pc + lengths8080[subs[op->count - 1].bytes[0]];
+		}
+		else{
+			e = before;
+			emit_fallback(&e, cache, op, cycles);
+		}
+	}
+
+	spill(&e);
+	if(last_native){
+		// handlers set PC themselves, native code only at the end of the block
+		emit_store_state16_imm(&e, offsetof(state_8080, pc), end_pc);
+	}
+	emit_epilogue(&e, cycles);
+
+	if(e.overflow){
+		return NULL;
+	}
+	j->used = e.p - j->code;
+	j->compiled++;
+	j->native_ops += native_ops;
+	j->fallback_ops += instructions - native_ops;
+	return start;
+}
+
+/**
+	Allocates the executable code region.
+	@param size: code region size in bytes
+	@return the JIT, or NULL if the host is not x86-64 or the region can't be mapped
+*/
+jit *jit_create(size_t size){
+#if defined(__x86_64__)
+	void *code = mmap(NULL, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(code == MAP_FAILED){
+		return NULL;
+	}
+	jit *j = (jit*)calloc(sizeof(jit), 1);
+	j->code = (uint8_t*)code;
+	j->size = size;
+	return j;
+#else
+	return NULL;
+#endif
+}
+
+/**
+	Unmaps the code region and frees the JIT.
+	@param j: the JIT
+*/
+void jit_destroy(jit *j){
+	if(j != NULL){
+		munmap(j->code, j->size);
+		free(j);
+	}
+}
+
+/**
+	Same as emulate_8080_run_cached, but runs blocks as native code from state->jit.
+	Needs state->cache. Without state->jit it runs the block cache.
+	@param state: the CPU state
+	@param budget: number of cycles to execute
+	@return the number of cycles executed
+*/
+int32_t emulate_8080_run_jit(state_8080 *state, int32_t budget){
+	block_cache *cache = state->cache;
+	jit *j = state->jit;
+	int32_t cycles = 0;
+
+	if(j == NULL){
+		return emulate_8080_run_cached(state, budget);
+	}
+
+	block_cache_free_retired(cache);
+
+	while(cycles < budget){
+		block *b = block_cache_lookup(state, state->pc);
+
+		if(b->native == NULL && !b->native_failed && b->count != 0){
+			b->native = compile_block(j, cache, b);
+			if(b->native == NULL){
+				// code region full: start over, the old blocks are retired with their code
+				block_cache_flush(cache);
+				j->used = 0;
+				j->flushes++;
+				b = block_cache_lookup(state, state->pc);
+				b->native = compile_block(j, cache, b);
+				b->native_failed = b->native == NULL;
+			}
+		}
+
+		state_8080 before;
+		if(b->loop){
+			before = *state;
+		}
+
+		if(b->native != NULL && cycles + b->head_cycles < budget){
+			// the whole block fits in the budget, so run it natively
+			int32_t done = ((int32_t (*)(state_8080*))b->native)(state);
+			cycles += done;
+			if(done == b->cycles){
+				state->instructions += b->instructions;
+				if(b->exit){
+					break;
+				}
+			}
+			else{
+				// left early after overwriting code, count the instructions that ran
+				for(decoded_op *op = b->ops; done > 0; op++){
+					done -= op->cycles;
+					state->instructions += op->count;
+				}
+			}
+		}
+		else if(block_cache_run_block(state, b, &cycles, budget)){
+			break;
+		}
+
+		if(b->loop){
+			block_cache_skip_idle(state, b, &before, &cycles, budget);
+		}
+	}
+
+	return cycles;
+}
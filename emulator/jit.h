@@ -0,0 +1,46 @@
+#include <stddef.h>
+#include <stdint.h>
+#include "emulator.h"
+
+#pragma once
+
+// default size of the executable code region
+#define JIT_CODE_SIZE (4 << 20)
+
+/**
+	x86-64 dynamic recompiler. Compiles the blocks of the block cache into native code; instructions
+	it has no native translation for are called through their handlers.
+*/
+typedef struct jit{
+	uint8_t *code;		// executable region
+	size_t size;
+	size_t used;
+
+	// statistics
+	uint64_t compiled;		// blocks compiled
+	uint64_t native_ops;	// instructions translated to native code
+	uint64_t fallback_ops;	// instructions compiled as handler calls
+	uint64_t flushes;		// times the code region filled up
+} jit;
+
+/**
+	Allocates the executable code region.
+	@param size: code region size in bytes
+	@return the JIT, or NULL if the host is not x86-64 or the region can't be mapped
+*/
+jit *jit_create(size_t size);
+
+/**
+	Unmaps the code region and frees the JIT.
+	@param j: the JIT
+*/
+void jit_destroy(jit *j);
+
+/**
+	Same as emulate_8080_run_cached, but runs blocks as native code from state->jit.
+	Needs state->cache. Without state->jit it runs the block cache.
+	@param state: the CPU state
+	@param budget: number of cycles to execute
+	@return the number of cycles executed
+*/
+int32_t emulate_8080_run_jit(state_8080 *state, int32_t budget);
@@ -1,13 +1,91 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include "emulator.h"
 #include "SIMachine.hpp"
+#include "SDLDisplay.hpp"
+#include "opcode_stats.h"
+#include "pc_profile.h"
+#include "callgraph.h"
+#include "trace.h"
 
 int main(int argc, char **argv){
-	SIMachine machine;
+	const char *stats_path = NULL;
+	const char *profile_path = NULL;
+	const char *calls_path = NULL;
+	const char *symbols_path = NULL;
+	const char *trace_path = NULL;
+	uint32_t trace_records = TRACE_RECORDS;
+	uint32_t interval = PC_PROFILE_INTERVAL;
+
+	// the display is created before the machine, the other options need the machine
+	uint8_t cpu_rotate = 0;
+	for(int i = 1; i < argc; i++){
+		if(strcmp(argv[i], "--cpu-rotate") == 0){
+			// upright ARGB8888 texture converted on the CPU, to compare with the rotated one
+			cpu_rotate = 1;
+		}
+	}
+
+	SDLDisplay display(cpu_rotate);
+	SIMachine machine(&display);
+
+	for(int i = 1; i < argc; i++){
+		if(strcmp(argv[i], "--turbo") == 0){
+			// uncapped, for soak tests and measuring the core
+			machine.turbo = 1;
+		}
+		else if(strcmp(argv[i], "--opcode-stats") == 0 && i + 1 < argc){
+			// count opcodes, report on exit
+			stats_path = argv[++i];
+			machine.count_opcodes();
+		}
+		else if(strcmp(argv[i], "--pc-profile") == 0 && i + 1 < argc){
+			// sample PC, folded stacks on exit
+			profile_path = argv[++i];
+		}
+		else if(strcmp(argv[i], "--call-graph") == 0 && i + 1 < argc){
+			// follow CALL and RET, call graph on exit
+			calls_path = argv[++i];
+			machine.profile_calls();
+		}
+		else if(strcmp(argv[i], "--trace") == 0 && i + 1 < argc){
+			// last instructions in a file, read with tracedump
+			trace_path = argv[++i];
+		}
+		else if(strcmp(argv[i], "--trace-records") == 0 && i + 1 < argc){
+			trace_records = strtoul(argv[++i], NULL, 10);
+		}
+		else if(strcmp(argv[i], "--symbols") == 0 && i + 1 < argc){
+			symbols_path = argv[++i];
+		}
+		else if(strcmp(argv[i], "--sample-interval") == 0 && i + 1 < argc){
+			interval = strtoul(argv[++i], NULL, 10);
+		}
+	}
+	if(profile_path != NULL){
+		if(interval == 0){
+			printf("--sample-interval needs a number of cycles above 0\n");
+			return 1;
+		}
+		machine.profile_pc(interval);
+	}
+	if(trace_path != NULL && !machine.trace_to(trace_path, trace_records)){
+		return 1;
+	}
 
 	machine.start_emulation();
 
+	if(stats_path != NULL){
+		opcode_stats_dump(machine.state->stats, stats_path);
+	}
+	if(profile_path != NULL){
+		pc_profile_dump(machine.profile, symbols_path, profile_path);
+	}
+	if(calls_path != NULL){
+		callgraph_dump(machine.state->calls, symbols_path, calls_path);
+	}
+
 	return 0;
-}
\ No newline at end of file
+}
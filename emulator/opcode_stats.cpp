@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+#include "opcode_stats.h"
+#include "report.h"
+
+/**
+	@return new zeroed counters
+*/
+opcode_stats *opcode_stats_create(){
+	opcode_stats *stats = (opcode_stats*)calloc(sizeof(opcode_stats), 1);
+	stats->last = 0x100;
+	return stats;
+}
+
+/**
+	@param stats: the counters
+*/
+void opcode_stats_destroy(opcode_stats *stats){
+	free(stats);
+}
+
+/**
+	Prints the opcodes sorted by cycles, the most executed pairs and the interrupts.
+	@param stats: the counters
+	@param out: where to print
+	@param top: number of opcodes and pairs to list
+*/
+void opcode_stats_report(const opcode_stats *stats, FILE *out, uint32_t top){
+	uint64_t instructions = 0;
+	uint64_t cycles = 0;
+	for(int i = 0; i < 256; i++){
+		instructions += stats->count[i];
+		cycles += stats->cycles[i];
+	}
+	if(instructions == 0){
+		fprintf(out, "no instructions counted\n");
+		return;
+	}
+
+	std::vector<int> opcodes;
+	for(int i = 0; i < 256; i++){
+		if(stats->count[i]){
+			opcodes.push_back(i);
+		}
+	}
+	std::sort(opcodes.begin(), opcodes.end(), [stats](int a, int b){
+		return stats->cycles[a] > stats->cycles[b];
+	});
+
+	fprintf(out, "%llu instructions, %llu cycles\n\n", (unsigned long long)instructions, (unsigned long long)cycles);
+	fprintf(out, "opcode         count  %% count          cycles  %% cycles\n");
+	for(uint32_t i = 0; i < top && i < opcodes.size(); i++){
+		int op = opcodes[i];
+		fprintf(out, "    %02x  %12llu  %6.2f%%  %14llu  %7.2f%%\n", op, (unsigned long long)stats->count[op],
+				100.0 * stats->count[op] / instructions, (unsigned long long)stats->cycles[op],
+				100.0 * stats->cycles[op] / cycles);
+	}
+
+	// candidates for FUSION_LIST (fusion.h)
+	std::vector<int> pairs;
+	for(int i = 0; i < 0x10000; i++){
+		if(stats->pairs[i >> 8][i & 0xff]){
+			pairs.push_back(i);
+		}
+	}
+	std::sort(pairs.begin(), pairs.end(), [stats](int a, int b){
+		return stats->pairs[a >> 8][a & 0xff] > stats->pairs[b >> 8][b & 0xff];
+	});
+	fprintf(out, "\npair           count  %% count\n");
+	for(uint32_t i = 0; i < top && i < pairs.size(); i++){
+		uint64_t n = stats->pairs[pairs[i] >> 8][pairs[i] & 0xff];
+		fprintf(out, "  %02x %02x  %12llu  %6.2f%%\n", pairs[i] >> 8, pairs[i] & 0xff, (unsigned long long)n,
+				100.0 * n / instructions);
+	}
+
+	fprintf(out, "\ninterrupts:");
+	for(int i = 0; i < 8; i++){
+		if(stats->interrupts[i]){
+			fprintf(out, " RST %d: %llu", i, (unsigned long long)stats->interrupts[i]);
+		}
+	}
+	fprintf(out, "\n");
+}
+
+/**
+	Writes all the non-zero counters as JSON.
+	@param stats: the counters
+	@param out: where to write
+*/
+void opcode_stats_json(const opcode_stats *stats, FILE *out){
+	const char *separator = "";
+
+	fprintf(out, "{\n\t\"opcodes\": {");
+	for(int i = 0; i < 256; i++){
+		if(stats->count[i]){
+			fprintf(out, "%s\n\t\t\"%02x\": { \"count\": %llu, \"cycles\": %llu }", separator, i,
+					(unsigned long long)stats->count[i], (unsigned long long)stats->cycles[i]);
+			separator = ",";
+		}
+	}
+
+	separator = "";
+	fprintf(out, "\n\t},\n\t\"pairs\": {");
+	for(int i = 0; i < 0x10000; i++){
+		if(stats->pairs[i >> 8][i & 0xff]){
+			fprintf(out, "%s\n\t\t\"%02x%02x\": %llu", separator, i >> 8, i & 0xff,
+					(unsigned long long)stats->pairs[i >> 8][i & 0xff]);
+			separator = ",";
+		}
+	}
+
+	fprintf(out, "\n\t},\n\t\"interrupts\": [");
+	for(int i = 0; i < 8; i++){
+		fprintf(out, "%s%llu", i ? ", " : "", (unsigned long long)stats->interrupts[i]);
+	}
+	fprintf(out, "]\n}\n");
+}
+
+/**
+	report_dump callback for the report.
+*/
+static void report(const void *data, const symbol_map *map, FILE *out){
+	opcode_stats_report((const opcode_stats*)data, out, REPORT_TOP);
+}
+
+/**
+	report_dump callback for the JSON.
+*/
+static void json(const void *data, const symbol_map *map, FILE *out){
+	opcode_stats_json((const opcode_stats*)data, out);
+}
+
+/**
+	Prints the opcode report on stdout and writes the counters to a JSON file.
+	@param stats: the counters
+	@param path: JSON file
+*/
+void opcode_stats_dump(const opcode_stats *stats, const char *path){
+	report_dump(stats, report, json, NULL, path);
+}
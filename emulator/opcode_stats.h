@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <stdint.h>
+
+#pragma once
+
+/**
+	Execution counters filled by emulate_8080_run_stats, the instrumented build of the threaded
+	core. Plain runs use the other cores and never touch them.
+*/
+typedef struct opcode_stats{
+	uint64_t count[256];		// executions of every opcode
+	uint64_t cycles[256];		// cycles spent in every opcode
+	uint64_t pairs[256][256];	// executions of the second opcode right after the first, no interrupt between
+	uint64_t interrupts[8];		// interrupts taken, by RST number
+	uint16_t last;				// opcode executed last, 0x100 before the first one and after an interrupt
+} opcode_stats;
+
+/**
+	@return new zeroed counters
+*/
+opcode_stats *opcode_stats_create();
+
+/**
+	@param stats: the counters
+*/
+void opcode_stats_destroy(opcode_stats *stats);
+
+/**
+	Counts an executed instruction.
+	@param stats: the counters
+	@param opcode: the instruction opcode
+	@param cycles: cycles it took
+*/
+static inline void opcode_stats_count(opcode_stats *stats, uint8_t opcode, uint8_t cycles){
+	stats->count[opcode]++;
+	stats->cycles[opcode] += cycles;
+	if(stats->last < 0x100){
+		stats->pairs[stats->last][opcode]++;
+	}
+	stats->last = opcode;
+}
+
+/**
+	Prints the opcodes sorted by cycles, the most executed pairs and the interrupts.
+	@param stats: the counters
+	@param out: where to print
+	@param top: number of opcodes and pairs to list
+*/
+void opcode_stats_report(const opcode_stats *stats, FILE *out, uint32_t top);
+
+/**
+	Writes all the non-zero counters as JSON.
+	@param stats: the counters
+	@param out: where to write
+*/
+void opcode_stats_json(const opcode_stats *stats, FILE *out);
+
+/**
+	Prints the opcode report on stdout and writes the counters to a JSON file.
+	@param stats: the counters
+	@param path: JSON file
+*/
+void opcode_stats_dump(const opcode_stats *stats, const char *path);
@@ -0,0 +1,43 @@
+#include <stdint.h>
+#include <chrono>
+#include "pacer.h"
+
+/**
+	@return the wall clock in microseconds
+*/
+static double now_us(){
+	using namespace std::chrono;
+	return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+	Starts pacing from the current wall clock.
+	@param p: the pacer
+	@param hz: emulated clock frequency
+	@param cycles: current cycle count
+	@param max_lag: cycles the emulation may fall behind (a stalled host skips ahead instead of catching up)
+*/
+void pacer_start(pacer *p, uint32_t hz, uint64_t cycles, uint64_t max_lag){
+	p->hz = hz;
+	p->start_us = now_us();
+	p->start_cycles = cycles;
+	p->max_lag = max_lag;
+}
+
+/**
+	@param p: the pacer
+	@param cycles: current cycle count
+	@return the cycle count the emulation should run to now
+*/
+uint64_t pacer_release(pacer *p, uint64_t cycles){
+	double now = now_us();
+	uint64_t target = p->start_cycles + (uint64_t)((now - p->start_us) * p->hz / 1000000.0);
+
+	if(target > cycles + p->max_lag){
+		// the host stalled: restart the clock instead of running a burst to catch up
+		p->start_us = now;
+		p->start_cycles = cycles + p->max_lag;
+		target = p->start_cycles;
+	}
+	return target;
+}
@@ -0,0 +1,30 @@
+#include <stdint.h>
+
+#pragma once
+
+/**
+	Host pacing: decides how many emulated cycles to release so emulated time follows the wall
+	clock. It never affects what the emulation does, only how fast it goes.
+*/
+typedef struct pacer{
+	uint32_t hz;			// emulated clock
+	double start_us;		// wall clock the emulated time is measured from
+	uint64_t start_cycles;	// cycle count at start_us
+	uint64_t max_lag;		// cycles the emulation may fall behind before the pacer gives up on them
+} pacer;
+
+/**
+	Starts pacing from the current wall clock.
+	@param p: the pacer
+	@param hz: emulated clock frequency
+	@param cycles: current cycle count
+	@param max_lag: cycles the emulation may fall behind (a stalled host skips ahead instead of catching up)
+*/
+void pacer_start(pacer *p, uint32_t hz, uint64_t cycles, uint64_t max_lag);
+
+/**
+	@param p: the pacer
+	@param cycles: current cycle count
+	@return the cycle count the emulation should run to now
+*/
+uint64_t pacer_release(pacer *p, uint64_t cycles);
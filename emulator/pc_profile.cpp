@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include "pc_profile.h"
+#include "symbols.h"
+#include "report.h"
+
+/**
+	Samples of a routine.
+*/
+typedef struct routine{
+	std::string name;
+	uint64_t samples;
+	uint16_t hottest;	// address with the most samples
+} routine;
+
+/**
+	@param interval: emulated cycles between samples, 0 is taken as 1 so the samples move forward
+	@param now: current cycle count
+	@return a new empty profile, first sample due interval cycles from now
+*/
+pc_profile *pc_profile_create(uint32_t interval, uint64_t now){
+	pc_profile *p = (pc_profile*)calloc(sizeof(pc_profile), 1);
+	p->interval = interval != 0 ? interval : 1;
+	p->next = now + p->interval;
+	return p;
+}
+
+/**
+	@param p: the profile
+*/
+void pc_profile_destroy(pc_profile *p){
+	free(p);
+}
+
+/**
+	@param map: labels of the routines
+	@param addr: code address
+	@return the name of the routine addr belongs to
+*/
+static std::string routine_name(const symbol_map *map, uint16_t addr){
+	const symbol *s = symbol_map_find(map, addr);
+	if(s != NULL){
+		return s->name;
+	}
+	char text[8];
+	snprintf(text, sizeof(text), "%04x", addr & ~(PC_PROFILE_BUCKET - 1));
+	return text;
+}
+
+/**
+	Prints the routines ranked by samples, with the hottest address of each.
+	@param p: the profile
+	@param map: labels of the routines, PC_PROFILE_BUCKET sized buckets where there is none
+	@param out: where to print
+	@param top: number of routines to list
+*/
+void pc_profile_report(const pc_profile *p, const symbol_map *map, FILE *out, uint32_t top){
+	if(p->total == 0){
+		fprintf(out, "no samples\n");
+		return;
+	}
+
+	std::map<std::string, routine> routines;
+	for(uint32_t addr = 0; addr < 0x10000; addr++){
+		if(p->samples[addr] == 0){
+			continue;
+		}
+		std::string name = routine_name(map, addr);
+		routine &r = routines[name];
+		if(r.samples == 0 || p->samples[addr] > p->samples[r.hottest]){
+			r.hottest = addr;
+		}
+		r.name = name;
+		r.samples += p->samples[addr];
+	}
+
+	std::vector<routine> ranked;
+	for(auto &r : routines){
+		ranked.push_back(r.second);
+	}
+	std::sort(ranked.begin(), ranked.end(), [](const routine &a, const routine &b){
+		return a.samples > b.samples;
+	});
+
+	fprintf(out, "%llu samples, one every %u cycles\n\n", (unsigned long long)p->total, p->interval);
+	fprintf(out, "     samples        %%  routine                           hottest\n");
+	for(uint32_t i = 0; i < top && i < ranked.size(); i++){
+		routine *r = &ranked[i];
+		fprintf(out, "%12llu  %6.2f%%  %-32s  %s\n", (unsigned long long)r->samples, 100.0 * r->samples / p->total,
+				r->name.c_str(), symbol_map_name(map, r->hottest).c_str());
+	}
+}
+
+/**
+	Writes the samples as folded stacks ("routine;address count" lines) for flame graph tools.
+	@param p: the profile
+	@param map: labels of the routines
+	@param out: where to write
+*/
+void pc_profile_folded(const pc_profile *p, const symbol_map *map, FILE *out){
+	for(uint32_t addr = 0; addr < 0x10000; addr++){
+		if(p->samples[addr]){
+			fprintf(out, "%s;%s %llu\n", routine_name(map, addr).c_str(), symbol_map_name(map, addr).c_str(),
+					(unsigned long long)p->samples[addr]);
+		}
+	}
+}
+
+/**
+	report_dump callback for the report.
+*/
+static void report(const void *data, const symbol_map *map, FILE *out){
+	pc_profile_report((const pc_profile*)data, map, out, REPORT_TOP);
+}
+
+/**
+	report_dump callback for the folded stacks.
+*/
+static void folded(const void *data, const symbol_map *map, FILE *out){
+	pc_profile_folded((const pc_profile*)data, map, out);
+}
+
+/**
+	Prints the ranked routines on stdout and writes the folded stacks to a file.
+	@param p: the profile
+	@param symbols_path: symbol file, NULL for none
+	@param folded_path: folded stacks file
+*/
+void pc_profile_dump(const pc_profile *p, const char *symbols_path, const char *folded_path){
+	report_dump(p, report, folded, symbols_path, folded_path);
+}
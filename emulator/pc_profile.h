@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <stdint.h>
+#include "symbols.h"
+
+#pragma once
+
+// samples every this many emulated cycles by default, prime so it doesn't follow the frame timing
+#define PC_PROFILE_INTERVAL 997
+
+// bytes of code per routine in reports without a symbol map
+#define PC_PROFILE_BUCKET 16
+
+/**
+	Sampling PC profile. The machine records PC every interval emulated cycles, from a scheduler
+	event, so the cores run unchanged.
+*/
+typedef struct pc_profile{
+	uint32_t interval;			// emulated cycles between samples
+	uint64_t next;				// cycle count of the next sample
+	uint64_t total;				// samples taken
+	uint64_t samples[0x10000];	// samples by PC
+} pc_profile;
+
+/**
+	@param interval: emulated cycles between samples, 0 is taken as 1 so the samples move forward
+	@param now: current cycle count
+	@return a new empty profile, first sample due interval cycles from now
+*/
+pc_profile *pc_profile_create(uint32_t interval, uint64_t now);
+
+/**
+	@param p: the profile
+*/
+void pc_profile_destroy(pc_profile *p);
+
+/**
+	Records a sample and moves to the next one.
+	@param p: the profile
+	@param pc: current PC
+*/
+static inline void pc_profile_sample(pc_profile *p, uint16_t pc){
+	p->samples[pc]++;
+	p->total++;
+	p->next += p->interval;
+}
+
+/**
+	Prints the routines ranked by samples, with the hottest address of each.
+	@param p: the profile
+	@param map: labels of the routines, PC_PROFILE_BUCKET sized buckets where there is none
+	@param out: where to print
+	@param top: number of routines to list
+*/
+void pc_profile_report(const pc_profile *p, const symbol_map *map, FILE *out, uint32_t top);
+
+/**
+	Writes the samples as folded stacks ("routine;address count" lines) for flame graph tools.
+	@param p: the profile
+	@param map: labels of the routines
+	@param out: where to write
+*/
+void pc_profile_folded(const pc_profile *p, const symbol_map *map, FILE *out);
+
+/**
+	Prints the ranked routines on stdout and writes the folded stacks to a file.
+	@param p: the profile
+	@param symbols_path: symbol file, NULL for none
+	@param folded_path: folded stacks file
+*/
+void pc_profile_dump(const pc_profile *p, const char *symbols_path, const char *folded_path);
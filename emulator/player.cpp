@@ -0,0 +1,23 @@
+#include <stdint.h>
+#include "player.h"
+
+/**
+	Scripted player for the fixed workloads (benchmark, fusion_miner): inserts a coin, starts a
+	game and then walks left and right, firing every other second. Sharing it keeps the workloads
+	the same instruction stream.
+	@param frame: frames run so far
+	@return input port 1 for the frame
+*/
+uint8_t player_input(uint64_t frame){
+	if(frame >= 100 && frame < 110){
+		return 0x01;	// coin
+	}
+	if(frame >= 200 && frame < 210){
+		return 0x04;	// start p1
+	}
+	if(frame >= 300){
+		// fire every other second, walk left and right
+		return ((frame / 60) % 2 ? 0x10 : 0) | ((frame / 150) % 2 ? 0x20 : 0x40);
+	}
+	return 0;
+}
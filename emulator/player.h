@@ -0,0 +1,12 @@
+#include <stdint.h>
+
+#pragma once
+
+/**
+	Scripted player for the fixed workloads (benchmark, fusion_miner): inserts a coin, starts a
+	game and then walks left and right, firing every other second. Sharing it keeps the workloads
+	the same instruction stream.
+	@param frame: frames run so far
+	@return input port 1 for the frame
+*/
+uint8_t player_input(uint64_t frame);
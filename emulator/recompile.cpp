@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "emulator.h"
+#include "block_cache.h"
+
+/*
+	Static recompiler for the Space Invaders ROM.
+
+	Walks the control flow of the ROM from the reset and interrupt vectors and writes every basic
+	block it finds as a C++ function calling the op<> handlers with constant operands, plus the
+	table used by emulate_8080_run_recompiled (recompiled.h). The ROM is write protected, so the
+	translation stays valid for the whole run.
+
+	Usage: recompile <rom directory> <output file>
+*/
+
+#define ROM_SIZE 0x2000
+
+// longest straight-line run written as one function
+#define MAX_BLOCK_OPS 64
+
+static uint8_t memory[0x10000];
+static uint8_t queued[ROM_SIZE];	// addresses already added to the worklist
+static uint16_t worklist[ROM_SIZE];
+static uint32_t worklist_size = 0;
+
+/**
+	Loads a ROM file.
+	@param dir: ROM directory
+	@param name: file name
+	@param offset: load address
+*/
+static void read_rom(const char *dir, const char *name, uint32_t offset){
+	char path[512];
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+
+	FILE *f = fopen(path, "rb");
+	if(f == NULL){
+		printf("ERROR: couldn't open %s\n", path);
+		exit(1);
+	}
+	fread(memory + offset, 1, 0x800, f);
+	fclose(f);
+}
+
+/**
+	Adds a block start address to the worklist, once.
+	@param addr: code address
+*/
+static void enqueue(uint16_t addr){
+	if(addr < ROM_SIZE && !queued[addr]){
+		queued[addr] = 1;
+		worklist[worklist_size++] = addr;
+	}
+}
+
+/**
+	@param opcode: instruction opcode
+	@return 1 if execution can continue with the next instruction
+*/
+static uint8_t falls_through(uint8_t opcode){
+	switch(opcode){
+		case 0xc3: case 0xcb:	// JMP
+		case 0xc9:				// RET
+		case 0xe9:				// PCHL
+			return 0;
+	}
+	return 1;
+}
+
+/**
+	Queues the static successors of a control transfer instruction.
+	@param pc: address of the instruction
+	@param opcode: the instruction
+*/
+static void enqueue_targets(uint16_t pc, uint8_t *opcode){
+	uint16_t target = (opcode[2] << 8) | opcode[1];
+
+	if((opcode[0] & 0xc7) == 0xc7){
+		// RST
+		enqueue(opcode[0] & 0x38);
+	}
+	else if(opcode[0] == 0xc3 || opcode[0] == 0xcb || opcode[0] == 0xcd ||
+			(opcode[0] & 0xc7) == 0xc2 || (opcode[0] & 0xc7) == 0xc4){
+		// JMP, CALL, Jcc, Ccc
+		enqueue(target);
+	}
+	if(falls_through(opcode[0])){
+		// not taken branches and returns from calls
+		enqueue(pc + lengths8080[opcode[0]]);
+	}
+}
+
+/**
+	Writes the function of the block starting at pc and queues its successors.
+	@param out: output file
+	@param pc: start address
+	@param exit: set to 1 if the block ends with EI
+	@param head_cycles: set to the cycles of all instructions but the last one
+	@return 1 if a function was written, 0 if the block is empty (IN/OUT at pc)
+*/
+static uint8_t write_block(FILE *out, uint16_t pc, uint8_t *exit, int32_t *head_cycles){
+	uint16_t addr = pc;
+	int32_t cycles = 0;
+	uint32_t count = 0;
+	uint8_t last = 0;
+
+	*exit = 0;
+	*head_cycles = 0;
+
+	if(memory[pc] == 0xdb || memory[pc] == 0xd3){
+		// IN/OUT are run by the host
+		enqueue(pc + 2);
+		return 0;
+	}
+
+	fprintf(out, "static int32_t block_%04x(state_8080 *state){\n", pc);
+	while(count < MAX_BLOCK_OPS && addr < ROM_SIZE){
+		uint8_t *opcode = memory + addr;
+		if(opcode[0] == 0xdb || opcode[0] == 0xd3){
+			// stop before IN/OUT, the core returns to the host when it sees them at PC
+			enqueue(addr);
+			break;
+		}
+
+		last = op_ends_block(opcode[0]);
+		if(last){
+			// handlers of control transfers need PC past the opcode, like emulate_8080_op sets it
+			fprintf(out, "\tstate->pc = 0x%04x;\n", addr + 1);
+		}
+		fprintf(out, "\t{ uint8_t o[] = { 0x%02x, 0x%02x, 0x%02x }; op<0x%02x>(state, o); }\t// %04x\n",
+				opcode[0], opcode[1], opcode[2], opcode[0], addr);
+
+		*head_cycles = cycles;
+		cycles += cycles8080[opcode[0]];
+		count++;
+
+		if(last){
+			enqueue_targets(addr, opcode);
+			break;
+		}
+		addr += lengths8080[opcode[0]];
+		if(opcode[0] == 0xfb){
+			// EI, the host may take an interrupt before the next instruction
+			*exit = 1;
+			enqueue(addr);
+			break;
+		}
+	}
+	if(!last){
+		if(count == MAX_BLOCK_OPS){
+			enqueue(addr);
+		}
+		fprintf(out, "\tstate->pc = 0x%04x;\n", addr);
+	}
+	fprintf(out, "\tstate->instructions += %u;\n", count);
+	fprintf(out, "\treturn %d;\n}\n\n", cycles);
+
+	return 1;
+}
+
+int main(int argc, char **argv){
+	if(argc != 3){
+		printf("Usage: %s <rom directory> <output file>\n", argv[0]);
+		return 1;
+	}
+
+	read_rom(argv[1], "invaders.h", 0x0);
+	read_rom(argv[1], "invaders.g", 0x800);
+	read_rom(argv[1], "invaders.f", 0x1000);
+	read_rom(argv[1], "invaders.e", 0x1800);
+
+	FILE *out = fopen(argv[2], "w");
+	if(out == NULL){
+		printf("ERROR: couldn't open %s\n", argv[2]);
+		return 1;
+	}
+
+	// reset and the vectors the machine raises (the interrupts are RST 1 and RST 2), the other RSTs
+	// are found like any other target if the ROM executes them
+	enqueue(0x0000);
+	enqueue(0x0008);
+	enqueue(0x0010);
+
+	fprintf(out, "// Generated by recompile from the Space Invaders ROM, do not edit.\n");
+	fprintf(out, "#include <stdint.h>\n#include \"emulator.h\"\n#include \"emulator_ops.h\"\n#include \"recompiled.h\"\n\n");
+
+	static uint16_t starts[ROM_SIZE];
+	static uint8_t exits[ROM_SIZE];
+	static int32_t head_cycles[ROM_SIZE];
+	uint32_t count = 0;
+
+	// the worklist grows while blocks are written
+	for(uint32_t i = 0; i < worklist_size; i++){
+		uint16_t pc = worklist[i];
+		if(write_block(out, pc, &exits[count], &head_cycles[count])){
+			starts[count++] = pc;
+		}
+	}
+
+	fprintf(out, "const recompiled_block recompiled_blocks[] = {\n");
+	for(uint32_t i = 0; i < count; i++){
+		fprintf(out, "\t{ 0x%04x, %d, %d, block_%04x },\n", starts[i], exits[i], head_cycles[i], starts[i]);
+	}
+	fprintf(out, "};\n\nconst uint32_t recompiled_block_count = %u;\n", count);
+	fclose(out);
+
+	printf("%u blocks\n", count);
+	return 0;
+}
@@ -0,0 +1,55 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "emulator.h"
+#include "recompiled.h"
+
+// recompiled block starting at every address, NULL where there is none
+static const recompiled_block *entries[0x10000];
+
+/**
+	Indexes the recompiled blocks by their start address. Call it once before running.
+*/
+void recompiled_init(){
+	for(uint32_t i = 0; i < recompiled_block_count; i++){
+		entries[recompiled_blocks[i].start] = &recompiled_blocks[i];
+	}
+}
+
+/**
+	Same as emulate_8080_run, but runs the recompiled blocks of the ROM. Addresses that are not
+	the start of a recompiled block (code in RAM, indirect jump targets the tool didn't find,
+	returns from interrupts) run through emulate_8080_op.
+	@param state: the CPU state
+	@param budget: number of cycles to execute
+	@return the number of cycles executed
+*/
+int32_t emulate_8080_run_recompiled(state_8080 *state, int32_t budget){
+	int32_t cycles = 0;
+
+	while(cycles < budget){
+		uint8_t opcode = state->memory[state->pc];
+		if(opcode == 0xdb || opcode == 0xd3){
+			// IN/OUT are handled by the host
+			break;
+		}
+
+		const recompiled_block *b = entries[state->pc];
+		if(b != NULL && cycles + b->head_cycles < budget){
+			// even the last instruction starts inside the budget, so run the whole block
+			cycles += b->run(state);
+			if(b->exit){
+				break;
+			}
+		}
+		else{
+			cycles += emulate_8080_op(state);
+			if(opcode == 0xfb){
+				// EI, give the host a chance to take a pending interrupt
+				break;
+			}
+		}
+	}
+
+	return cycles;
+}
@@ -0,0 +1,38 @@
+#include <stdint.h>
+#include "emulator.h"
+
+#pragma once
+
+// 1 to run the ROM translated ahead of time by the recompile tool (see the emulator-static target)
+#ifndef STATIC_RECOMPILED
+#define STATIC_RECOMPILED 0
+#endif
+
+/**
+	A basic block of the ROM translated to C++ by the recompile tool.
+*/
+typedef struct recompiled_block{
+	uint16_t start;
+	uint8_t exit;			// 1 if the block ends with EI, so the core returns to the host after it
+	int32_t head_cycles;	// cycles of all instructions but the last one
+	int32_t (*run)(state_8080 *state);	// runs the block, sets PC and returns the cycles executed
+} recompiled_block;
+
+// generated by the recompile tool
+extern const recompiled_block recompiled_blocks[];
+extern const uint32_t recompiled_block_count;
+
+/**
+	Indexes the recompiled blocks by their start address. Call it once before running.
+*/
+void recompiled_init();
+
+/**
+	Same as emulate_8080_run, but runs the recompiled blocks of the ROM. Addresses that are not
+	the start of a recompiled block (code in RAM, indirect jump targets the tool didn't find,
+	returns from interrupts) run through emulate_8080_op.
+	@param state: the CPU state
+	@param budget: number of cycles to execute
+	@return the number of cycles executed
+*/
+int32_t emulate_8080_run_recompiled(state_8080 *state, int32_t budget);
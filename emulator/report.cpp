@@ -0,0 +1,30 @@
+#include <stdio.h>
+#include <stdint.h>
+#include "report.h"
+#include "symbols.h"
+
+/**
+	Loads the symbols, prints the report of a profile on stdout and writes its file. Shared by the
+	profiles the drivers dump on exit (opcode_stats, pc_profile, callgraph).
+	@param data: the profile
+	@param report: prints the summary
+	@param output: writes the file
+	@param symbols_path: symbol file, NULL for none
+	@param path: output file
+*/
+void report_dump(const void *data, report_writer report, report_writer output, const char *symbols_path, const char *path){
+	symbol_map map;
+	if(symbols_path != NULL && !symbol_map_load(&map, symbols_path)){
+		printf("ERROR: couldn't open %s\n", symbols_path);
+	}
+
+	report(data, &map, stdout);
+
+	FILE *f = fopen(path, "w");
+	if(f == NULL){
+		printf("ERROR: couldn't open %s\n", path);
+		return;
+	}
+	output(data, &map, f);
+	fclose(f);
+}
@@ -0,0 +1,27 @@
+#include <stdio.h>
+#include <stdint.h>
+#include "symbols.h"
+
+#pragma once
+
+// entries listed in the reports printed on exit
+#define REPORT_TOP 30
+
+/**
+	Prints or writes a profile.
+	@param data: the profile
+	@param map: labels of the routines, empty if no symbol file was given
+	@param out: where to print or write
+*/
+typedef void (*report_writer)(const void *data, const symbol_map *map, FILE *out);
+
+/**
+	Loads the symbols, prints the report of a profile on stdout and writes its file. Shared by the
+	profiles the drivers dump on exit (opcode_stats, pc_profile, callgraph).
+	@param data: the profile
+	@param report: prints the summary
+	@param output: writes the file
+	@param symbols_path: symbol file, NULL for none
+	@param path: output file
+*/
+void report_dump(const void *data, report_writer report, report_writer output, const char *symbols_path, const char *path);
@@ -0,0 +1,54 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "scheduler.h"
+
+/**
+	Empties the queue.
+	@param s: the scheduler
+*/
+void scheduler_init(scheduler *s){
+	s->count = 0;
+}
+
+/**
+	Queues an event. Events due at the same cycle are popped in the order they were added.
+	@param s: the scheduler
+	@param when: cycle the event is due at
+	@param type: event type
+*/
+void scheduler_add(scheduler *s, uint64_t when, uint32_t type){
+	if(s->count == SCHEDULER_MAX_EVENTS){
+		printf("ERROR: scheduler queue full\n");
+		exit(1);
+	}
+
+	// the queue is tiny, a sorted insert is enough
+	uint32_t i = s->count;
+	while(i > 0 && s->events[i - 1].when > when){
+		s->events[i] = s->events[i - 1];
+		i--;
+	}
+	s->events[i].when = when;
+	s->events[i].type = type;
+	s->count++;
+}
+
+/**
+	Removes the next event if it is due.
+	@param s: the scheduler
+	@param now: current cycle count
+	@param type: set to the type of the event
+	@return 1 if an event was due
+*/
+uint8_t scheduler_pop(scheduler *s, uint64_t now, uint32_t *type){
+	if(s->count == 0 || s->events[0].when > now){
+		return 0;
+	}
+
+	*type = s->events[0].type;
+	s->count--;
+	memmove(s->events, s->events + 1, s->count * sizeof(sched_event));
+	return 1;
+}
@@ -0,0 +1,52 @@
+#include <stdint.h>
+
+#pragma once
+
+#define SCHEDULER_MAX_EVENTS 8
+
+/**
+	An event due at a given emulated cycle.
+*/
+typedef struct sched_event{
+	uint64_t when;	// cycle count (state_8080.cycles) the event is due at
+	uint32_t type;	// meaning is up to the machine
+} sched_event;
+
+/**
+	Queue of events in emulated time, sorted by due cycle.
+*/
+typedef struct scheduler{
+	sched_event events[SCHEDULER_MAX_EVENTS];
+	uint32_t count;
+} scheduler;
+
+/**
+	Empties the queue.
+	@param s: the scheduler
+*/
+void scheduler_init(scheduler *s);
+
+/**
+	Queues an event. Events due at the same cycle are popped in the order they were added.
+	@param s: the scheduler
+	@param when: cycle the event is due at
+	@param type: event type
+*/
+void scheduler_add(scheduler *s, uint64_t when, uint32_t type);
+
+/**
+	@param s: the scheduler
+	@return the cycle the next event is due at, UINT64_MAX if the queue is empty
+*/
+static inline uint64_t scheduler_next(const scheduler *s){
+	return s->count ? s->events[0].when : UINT64_MAX;
+}
+
+/**
+	Removes the next event if it is due.
+	@param s: the scheduler
+	@param now: current cycle count
+	@param type: set to the type of the event
+	@return 1 if an event was due
+*/
+uint8_t scheduler_pop(scheduler *s, uint64_t now, uint32_t *type);
@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <algorithm>
+#include "symbols.h"
+
+/**
+	Parses a hex address like 1a5c, $1A5C, 0x1a5c or 1A5Ch.
+	@param text: the token
+	@param addr: set to the address
+	@return 0 if the token is not an address
+*/
+static uint8_t parse_addr(const char *text, uint16_t *addr){
+	if(text[0] == '$'){
+		text++;
+	}
+	else if(text[0] == '0' && (text[1] == 'x' || text[1] == 'X')){
+		text += 2;
+	}
+
+	uint32_t value = 0;
+	int digits = 0;
+	for(; isxdigit(*text); text++, digits++){
+		value = value * 16 + (isdigit(*text) ? *text - '0' : tolower(*text) - 'a' + 10);
+	}
+	if(*text == 'h' || *text == 'H' || *text == ':'){
+		text++;
+	}
+	if(*text != 0 || digits == 0 || value > 0xffff){
+		return 0;
+	}
+	*addr = value;
+	return 1;
+}
+
+/**
+	Loads label/address pairs, one per line in either order ("1A5C ClearScreen" or
+	"ClearScreen $1A5C"). Addresses are hex, with an optional $, 0x or h. Lines starting with ; or #
+	are comments.
+	@param map: the map, the labels are added to it
+	@param path: symbol file
+	@return 0 if the file couldn't be read
+*/
+uint8_t symbol_map_load(symbol_map *map, const char *path){
+	FILE *f = fopen(path, "r");
+	if(f == NULL){
+		return 0;
+	}
+
+	char line[256];
+	while(fgets(line, sizeof(line), f) != NULL){
+		char first[128], second[128];
+		if(line[0] == ';' || line[0] == '#' || sscanf(line, "%127s %127s", first, second) != 2){
+			continue;
+		}
+
+		symbol s;
+		if(parse_addr(first, &s.addr)){
+			s.name = second;
+		}
+		else if(parse_addr(second, &s.addr)){
+			s.name = first;
+		}
+		else{
+			continue;
+		}
+		if(s.name.back() == ':'){
+			s.name.pop_back();
+		}
+		map->symbols.push_back(s);
+	}
+	fclose(f);
+
+	std::stable_sort(map->symbols.begin(), map->symbols.end(), [](const symbol &a, const symbol &b){
+		return a.addr < b.addr;
+	});
+	return 1;
+}
+
+/**
+	@param map: the map
+	@param addr: code address
+	@return the label at or before addr, NULL if there is none
+*/
+const symbol *symbol_map_find(const symbol_map *map, uint16_t addr){
+	auto it = std::upper_bound(map->symbols.begin(), map->symbols.end(), addr, [](uint16_t a, const symbol &s){
+		return a < s.addr;
+	});
+	if(it == map->symbols.begin()){
+		return NULL;
+	}
+	return &*(it - 1);
+}
+
+/**
+	Names an address as label+offset, or as the bare address without a label.
+	@param map: the map
+	@param addr: code address
+	@return the name
+*/
+std::string symbol_map_name(const symbol_map *map, uint16_t addr){
+	char text[16];
+	const symbol *s = symbol_map_find(map, addr);
+	if(s == NULL){
+		snprintf(text, sizeof(text), "%04x", addr);
+		return text;
+	}
+	if(s->addr == addr){
+		return s->name;
+	}
+	snprintf(text, sizeof(text), "+%x", addr - s->addr);
+	return s->name + text;
+}
@@ -0,0 +1,45 @@
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#pragma once
+
+/**
+	A label of the ROM listing.
+*/
+typedef struct symbol{
+	uint16_t addr;
+	std::string name;
+} symbol;
+
+/**
+	Labels by address, to name the routines in profiles.
+*/
+typedef struct symbol_map{
+	std::vector<symbol> symbols;	// sorted by address
+} symbol_map;
+
+/**
+	Loads label/address pairs, one per line in either order ("1A5C ClearScreen" or
+	"ClearScreen $1A5C"). Addresses are hex, with an optional $, 0x or h. Lines starting with ; or #
+	are comments.
+	@param map: the map, the labels are added to it
+	@param path: symbol file
+	@return 0 if the file couldn't be read
+*/
+uint8_t symbol_map_load(symbol_map *map, const char *path);
+
+/**
+	@param map: the map
+	@param addr: code address
+	@return the label at or before addr, NULL if there is none
+*/
+const symbol *symbol_map_find(const symbol_map *map, uint16_t addr);
+
+/**
+	Names an address as label+offset, or as the bare address without a label.
+	@param map: the map
+	@param addr: code address
+	@return the name
+*/
+std::string symbol_map_name(const symbol_map *map, uint16_t addr);
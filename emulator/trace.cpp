@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "trace.h"
+
+uint32_t disassemble8080op(uint8_t *buffer, uint32_t pc);
+
+/**
+	Sets up an empty ring in a new mapping.
+	@param mapping: header followed by the records
+	@param size: bytes mapped
+	@param records: capacity, a power of 2
+	@return the trace
+*/
+static trace *trace_init(void *mapping, size_t size, uint32_t records){
+	trace *t = (trace*)calloc(sizeof(trace), 1);
+	t->header = (trace_header*)mapping;
+	t->records = (trace_record*)(t->header + 1);
+	t->mask = records - 1;
+	t->size = size;
+
+	memcpy(t->header->magic, TRACE_MAGIC, sizeof(t->header->magic));
+	t->header->record_size = sizeof(trace_record);
+	t->header->capacity = records;
+	t->header->count = 0;
+	return t;
+}
+
+/**
+	Creates a trace file and maps it.
+	@param path: trace file, truncated, NULL to keep the records in memory only
+	@param capacity: records to keep, rounded up to a power of 2
+	@return the trace, NULL if the file couldn't be created
+*/
+trace *trace_create(const char *path, uint32_t capacity){
+	uint32_t records = 1;
+	while(records < capacity && records < (1u << 31)){
+		records <<= 1;
+	}
+	size_t size = sizeof(trace_header) + (size_t)records * sizeof(trace_record);
+
+	void *mapping;
+	if(path == NULL){
+		mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if(mapping == MAP_FAILED){
+			printf("ERROR: couldn't allocate the trace\n");
+			return NULL;
+		}
+		return trace_init(mapping, size, records);
+	}
+
+	int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0){
+		printf("ERROR: couldn't create %s\n", path);
+		return NULL;
+	}
+	if(ftruncate(fd, size) != 0){
+		printf("ERROR: couldn't size %s\n", path);
+		close(fd);
+		return NULL;
+	}
+	mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);	// the mapping keeps the file
+	if(mapping == MAP_FAILED){
+		printf("ERROR: couldn't map %s\n", path);
+		return NULL;
+	}
+	return trace_init(mapping, size, records);
+}
+
+/**
+	Maps an existing trace file to read it.
+	@param path: trace file
+	@return the trace, NULL if the file is not a trace
+*/
+trace *trace_open(const char *path){
+	int fd = open(path, O_RDONLY);
+	if(fd < 0){
+		printf("ERROR: couldn't open %s\n", path);
+		return NULL;
+	}
+	struct stat st;
+	if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(trace_header)){
+		printf("ERROR: %s is not a trace file\n", path);
+		close(fd);
+		return NULL;
+	}
+	void *mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(mapping == MAP_FAILED){
+		printf("ERROR: couldn't map %s\n", path);
+		return NULL;
+	}
+
+	trace_header *header = (trace_header*)mapping;
+	if(memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic)) != 0 || header->record_size != sizeof(trace_record) ||
+	   header->capacity == 0 || (header->capacity & (header->capacity - 1)) != 0 ||
+	   (size_t)st.st_size < sizeof(trace_header) + (size_t)header->capacity * sizeof(trace_record)){
+		printf("ERROR: %s is not a trace file or is truncated\n", path);
+		munmap(mapping, st.st_size);
+		return NULL;
+	}
+
+	trace *t = (trace*)calloc(sizeof(trace), 1);
+	t->header = header;
+	t->records = (trace_record*)(header + 1);
+	t->mask = header->capacity - 1;
+	t->size = st.st_size;
+	return t;
+}
+
+/**
+	Unmaps the trace. The file keeps the records.
+	@param t: the trace
+*/
+void trace_destroy(trace *t){
+	munmap(t->header, t->size);
+	free(t);
+}
+
+/**
+	Prints a record on one line: cycle, registers, flags, then the disassembly.
+	@param r: the record
+*/
+void trace_print(const trace_record *r){
+	// the disassembler reads the instruction from memory
+	static uint8_t memory[0x10000 + 2];
+	memcpy(memory + r->pc, r->op, sizeof(r->op));
+
+	printf("%12llu  A:%02x B:%02x C:%02x D:%02x E:%02x H:%02x L:%02x SP:%04x %c%c%c%c%c%c  ",
+			(unsigned long long)r->cycle, r->a, r->b, r->c, r->d, r->e, r->h, r->l, r->sp,
+			r->psw & FLAG_S ? 's' : '.', r->psw & FLAG_Z ? 'z' : '.', r->psw & FLAG_AC ? 'a' : '.',
+			r->psw & FLAG_P ? 'p' : '.', r->psw & FLAG_CY ? 'c' : '.', r->int_enable ? 'i' : '.');
+	disassemble8080op(memory, r->pc);
+}
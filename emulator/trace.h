@@ -0,0 +1,126 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "emulator.h"
+
+#pragma once
+
+// records kept by default, the last 1M instructions (24 MB)
+#define TRACE_RECORDS (1 << 20)
+
+#define TRACE_MAGIC "8080TRC1"
+
+/**
+	CPU state before an instruction. Fixed size, so a record is a few stores and the file can be
+	read back without parsing.
+*/
+typedef struct trace_record{
+	uint64_t cycle;		// cycle count when the instruction started
+	uint16_t pc;
+	uint16_t sp;
+	uint8_t op[3];		// instruction bytes, lengths8080 of them are meaningful
+	uint8_t psw;
+	uint8_t a;
+	uint8_t b;
+	uint8_t c;
+	uint8_t d;
+	uint8_t e;
+	uint8_t h;
+	uint8_t l;
+	uint8_t int_enable;
+} trace_record;
+
+static_assert(sizeof(trace_record) == 24, "trace records are written to files as is");
+
+/**
+	Start of a trace file, followed by capacity records. Record i is at index i % capacity, so
+	the file holds the last capacity records of count.
+*/
+typedef struct trace_header{
+	char magic[8];			// TRACE_MAGIC
+	uint32_t record_size;	// sizeof(trace_record)
+	uint32_t capacity;		// records in the ring, a power of 2
+	uint64_t count;			// records written since the trace started
+} trace_header;
+
+/**
+	Instruction trace. The ring lives in a shared mapping of the trace file, so the file is up
+	to date without any writes and survives the emulator crashing or exiting. Traces without a
+	file keep the ring in memory.
+*/
+typedef struct trace{
+	trace_header *header;	// start of the mapping
+	trace_record *records;	// the ring, right after the header
+	uint32_t mask;			// capacity - 1
+	size_t size;			// bytes mapped
+} trace;
+
+/**
+	Creates a trace file and maps it.
+	@param path: trace file, truncated, NULL to keep the records in memory only
+	@param capacity: records to keep, rounded up to a power of 2
+	@return the trace, NULL if the file couldn't be created
+*/
+trace *trace_create(const char *path, uint32_t capacity);
+
+/**
+	Maps an existing trace file to read it.
+	@param path: trace file
+	@return the trace, NULL if the file is not a trace
+*/
+trace *trace_open(const char *path);
+
+/**
+	Unmaps the trace. The file keeps the records.
+	@param t: the trace
+*/
+void trace_destroy(trace *t);
+
+/**
+	@param t: the trace
+	@return the number of the oldest record still in the ring
+*/
+static inline uint64_t trace_first(const trace *t){
+	uint64_t capacity = (uint64_t)t->mask + 1;
+	return t->header->count > capacity ? t->header->count - capacity : 0;
+}
+
+/**
+	@param t: the trace
+	@param i: record number, from trace_first(t) to t->header->count - 1
+	@return the record
+*/
+static inline const trace_record *trace_get(const trace *t, uint64_t i){
+	return &t->records[i & t->mask];
+}
+
+/**
+	Prints a record on one line: cycle, registers, flags, then the disassembly.
+	@param r: the record
+*/
+void trace_print(const trace_record *r);
+
+/**
+	Records the state before an instruction. Call materialize_flags first, so the PSW is current.
+	@param t: the trace
+	@param state: the CPU state
+	@param pc: address of the instruction
+	@param cycle: cycle count when the instruction started
+*/
+static inline void trace_add(trace *t, const state_8080 *state, uint16_t pc, uint64_t cycle){
+	trace_record *r = &t->records[t->header->count++ & t->mask];
+	r->cycle = cycle;
+	r->pc = pc;
+	r->sp = state->sp;
+	r->op[0] = state->memory[pc];
+	r->op[1] = state->memory[(uint16_t)(pc + 1)];
+	r->op[2] = state->memory[(uint16_t)(pc + 2)];
+	r->psw = state->cc.psw;
+	r->a = state->a;
+	r->b = state->b;
+	r->c = state->c;
+	r->d = state->d;
+	r->e = state->e;
+	r->h = state->h;
+	r->l = state->l;
+	r->int_enable = state->int_enable;
+}
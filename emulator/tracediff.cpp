@@ -0,0 +1,371 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "emulator.h"
+#include "SIMachine.hpp"
+#include "Display.hpp"
+#include "block_cache.h"
+#include "jit.h"
+#include "trace.h"
+
+/*
+	Finds where two runs of the emulator stop agreeing.
+
+	With two trace files (--trace of the drivers or -trace of the exerciser, for example from an
+	eager and a LAZY_FLAGS build) it walks the records both files kept and prints the first one
+	that differs, with the records before it.
+
+	With -cores it runs two machines on different cores side by side, comparing the registers, the
+	counters and the whole memory at a checkpoint every -checkpoint cycles (one frame by default).
+	When a checkpoint differs, it goes back to the last good one and bisects the cycle count down to
+	the instruction after which the machines disagree, so long runs cost a comparison per
+	checkpoint instead of per instruction. The context before that instruction comes from a trace of
+	the instrumented core.
+
+	Usage: tracediff [-context n] <trace a> <trace b>
+		   tracediff -cores ref test [-frames n] [-checkpoint cycles] [-context n]
+	Cores: op, run, cached, jit
+*/
+
+#define CONTEXT_RECORDS 20		// records printed before the first difference
+#define MEMORY_DIFFERENCES 32	// differing bytes listed, the rest are only counted
+
+/**
+	Interpreter core for the lockstep runs: emulate_8080_op until the budget is used, stopping on
+	IN and OUT and after EI like the other cores.
+	@param state: the CPU state
+	@param budget: number of cycles to execute
+	@return the number of cycles executed
+*/
+static int32_t run_op(state_8080 *state, int32_t budget){
+	int32_t cycles = 0;
+	while(cycles < budget){
+		uint8_t opcode = state->memory[state->pc];
+		if(opcode == 0xdb || opcode == 0xd3){
+			break;
+		}
+		cycles += emulate_8080_op(state);
+		if(opcode == 0xfb){
+			break;
+		}
+	}
+	return cycles;
+}
+
+/**
+	@param name: core name from the command line
+	@return the core, NULL if there is none by that name
+*/
+static int32_t (*find_core(const char *name))(state_8080*, int32_t){
+	if(strcmp(name, "op") == 0){
+		return run_op;
+	}
+	if(strcmp(name, "run") == 0){
+		return emulate_8080_run;
+	}
+	if(strcmp(name, "cached") == 0){
+		return emulate_8080_run_cached;
+	}
+	if(strcmp(name, "jit") == 0){
+		return emulate_8080_run_jit;
+	}
+	return NULL;
+}
+
+/**
+	Counts a differing value, and prints it if asked to.
+	@param name: what the value is
+	@param a: value of the first run
+	@param b: value of the second run
+	@param print: 1 to print the difference
+	@return 1 if the values differ
+*/
+static uint32_t field(const char *name, uint64_t a, uint64_t b, uint8_t print){
+	if(a == b){
+		return 0;
+	}
+	if(print){
+		printf("  %-12s %8llx %8llx\n", name, (unsigned long long)a, (unsigned long long)b);
+	}
+	return 1;
+}
+
+/**
+	Compares two trace records field by field.
+	@param a: record of the first trace
+	@param b: record of the second trace
+	@param print: 1 to print the differences
+	@return the number of differing fields
+*/
+static uint32_t record_differences(const trace_record *a, const trace_record *b, uint8_t print){
+	uint32_t n = 0;
+	n += field("cycle", a->cycle, b->cycle, print);
+	n += field("pc", a->pc, b->pc, print);
+	n += field("sp", a->sp, b->sp, print);
+	n += field("opcode", a->op[0], b->op[0], print);
+	n += field("operands", (a->op[1] << 8) | a->op[2], (b->op[1] << 8) | b->op[2], print);
+	n += field("flags", a->psw, b->psw, print);
+	n += field("a", a->a, b->a, print);
+	n += field("b", a->b, b->b, print);
+	n += field("c", a->c, b->c, print);
+	n += field("d", a->d, b->d, print);
+	n += field("e", a->e, b->e, print);
+	n += field("h", a->h, b->h, print);
+	n += field("l", a->l, b->l, print);
+	n += field("int_enable", a->int_enable, b->int_enable, print);
+	return n;
+}
+
+/**
+	Compares two machines: registers, counters, machine state and the whole memory.
+	@param a: first machine
+	@param b: second machine
+	@param print: 1 to print the differences
+	@return the number of differing values
+*/
+static uint32_t machine_differences(SIMachine *a, SIMachine *b, uint8_t print){
+	state_8080 *x = a->state;
+	state_8080 *y = b->state;
+	materialize_flags(x);
+	materialize_flags(y);
+
+	uint32_t n = 0;
+	n += field("cycles", x->cycles, y->cycles, print);
+	n += field("instructions", x->instructions, y->instructions, print);
+	n += field("pc", x->pc, y->pc, print);
+	n += field("sp", x->sp, y->sp, print);
+	n += field("flags", x->cc.psw, y->cc.psw, print);
+	n += field("a", x->a, y->a, print);
+	n += field("b", x->b, y->b, print);
+	n += field("c", x->c, y->c, print);
+	n += field("d", x->d, y->d, print);
+	n += field("e", x->e, y->e, print);
+	n += field("h", x->h, y->h, print);
+	n += field("l", x->l, y->l, print);
+	n += field("int_enable", x->int_enable, y->int_enable, print);
+	n += field("pending_int", a->pending_int, b->pending_int, print);
+	n += field("shift0", a->shift0, b->shift0, print);
+	n += field("shift1", a->shift1, b->shift1, print);
+	n += field("shift_offset", a->shift_offset, b->shift_offset, print);
+
+	if(memcmp(x->memory, y->memory, 0x10000) == 0){
+		return n;
+	}
+	uint32_t bytes = 0;
+	for(uint32_t addr = 0; addr < 0x10000; addr++){
+		if(x->memory[addr] != y->memory[addr]){
+			if(print && bytes < MEMORY_DIFFERENCES){
+				char name[16];
+				snprintf(name, sizeof(name), "[%04x]", addr);
+				field(name, x->memory[addr], y->memory[addr], print);
+			}
+			bytes++;
+		}
+	}
+	if(print && bytes > MEMORY_DIFFERENCES){
+		printf("  ... %u bytes differ\n", bytes);
+	}
+	return n + bytes;
+}
+
+/**
+	Walks the records both traces kept and reports the first difference.
+	@param path_a: first trace file
+	@param path_b: second trace file
+	@param context: records to print before the difference
+	@return 0 if the traces agree
+*/
+static int compare_traces(const char *path_a, const char *path_b, uint32_t context){
+	trace *a = trace_open(path_a);
+	trace *b = trace_open(path_b);
+	if(a == NULL || b == NULL){
+		return 2;
+	}
+
+	// the rings may have kept different ranges, only the common one can be compared
+	uint64_t first = trace_first(a) > trace_first(b) ? trace_first(a) : trace_first(b);
+	uint64_t count = a->header->count < b->header->count ? a->header->count : b->header->count;
+	int result = 0;
+
+	for(uint64_t i = first; i < count; i++){
+		const trace_record *ra = trace_get(a, i);
+		const trace_record *rb = trace_get(b, i);
+		if(memcmp(ra, rb, sizeof(trace_record)) == 0){
+			continue;
+		}
+
+		printf("traces differ at record %llu\n", (unsigned long long)i);
+		for(uint64_t j = i - first > context ? i - context : first; j < i; j++){
+			trace_print(trace_get(a, j));
+		}
+		printf("a:");
+		trace_print(ra);
+		printf("b:");
+		trace_print(rb);
+		printf("  %-12s %8s %8s\n", "", "a", "b");
+		record_differences(ra, rb, 1);
+		result = 1;
+		break;
+	}
+
+	if(result == 0){
+		printf("traces agree on records %llu to %llu\n", (unsigned long long)first, (unsigned long long)count);
+		if(a->header->count != b->header->count){
+			printf("%s has %llu more records\n", a->header->count > b->header->count ? path_a : path_b,
+					(unsigned long long)(a->header->count > b->header->count ? a->header->count - b->header->count :
+																			   b->header->count - a->header->count));
+			result = 1;
+		}
+	}
+
+	trace_destroy(a);
+	trace_destroy(b);
+	return result;
+}
+
+/**
+	Narrows a divergence down to one instruction and prints it.
+	@param a: reference machine
+	@param b: machine under test
+	@param good: last checkpoint where the machines agreed
+	@param bad: cycle count where they disagree
+	@param context: records to print before the instruction
+*/
+static void find_divergence(SIMachine *a, SIMachine *b, const SISnapshot *good, uint64_t bad, uint32_t context){
+	uint64_t low = good->cpu.cycles;
+	uint64_t high = bad;
+
+	// run_until is split invariant, so both machines can be rerun to any cycle count from the checkpoint
+	while(high - low > 1){
+		uint64_t mid = low + (high - low) / 2;
+		a->restore(good);
+		b->restore(good);
+		a->run_until(mid);
+		b->run_until(mid);
+		if(machine_differences(a, b, 0) == 0){
+			low = mid;
+		}
+		else{
+			high = mid;
+		}
+	}
+
+	// the instructions up to the divergence, from the instrumented core
+	int32_t (*core)(state_8080*, int32_t) = a->core;
+	a->restore(good);
+	a->state->trace = trace_create(NULL, context + 1);
+	if(a->state->trace != NULL){
+		a->core = emulate_8080_run_stats;
+		a->run_until(high);
+		printf("machines diverge at cycle %llu, after:\n", (unsigned long long)low);
+		// the ring is rounded up to a power of 2, so it may hold more than asked for
+		uint64_t count = a->state->trace->header->count;
+		uint64_t first = count > context + 1 ? count - (context + 1) : 0;
+		for(uint64_t i = first; i < count; i++){
+			trace_print(trace_get(a->state->trace, i));
+		}
+		trace_destroy(a->state->trace);
+		a->state->trace = NULL;
+		a->core = core;
+	}
+
+	a->restore(good);
+	b->restore(good);
+	a->run_until(high);
+	b->run_until(high);
+	printf("  %-12s %8s %8s\n", "", "ref", "test");
+	machine_differences(a, b, 1);
+}
+
+/**
+	Runs two machines side by side and reports the first instruction after which they differ.
+	@param ref: reference core
+	@param test: core under test
+	@param frames: frames to run
+	@param interval: cycles between checkpoints
+	@param context: instructions to print before the divergence
+	@return 0 if the machines agree to the end
+*/
+static int lockstep(int32_t (*ref)(state_8080*, int32_t), int32_t (*test)(state_8080*, int32_t), uint64_t frames,
+					uint64_t interval, uint32_t context){
+	NullDisplay display_a;
+	NullDisplay display_b;
+	SIMachine a(&display_a);
+	SIMachine b(&display_b);
+	a.core = ref;
+	b.core = test;
+
+	SISnapshot *good = new SISnapshot;
+	a.save(good);
+	uint64_t end = frames * CPU_HZ / FRAME_HZ;
+	int result = 0;
+
+	for(uint64_t target = interval; ; target += interval){
+		if(target > end){
+			target = end;
+		}
+		a.run_until(target);
+		b.run_until(target);
+		if(machine_differences(&a, &b, 0) != 0){
+			find_divergence(&a, &b, good, target, context);
+			result = 1;
+			break;
+		}
+		a.save(good);
+		if(target >= end){
+			break;
+		}
+	}
+
+	if(result == 0){
+		printf("cores agree for %llu frames, %llu instructions\n", (unsigned long long)frames,
+				(unsigned long long)a.state->instructions);
+	}
+	delete good;
+	return result;
+}
+
+int main(int argc, char **argv){
+	int32_t (*ref)(state_8080*, int32_t) = NULL;
+	int32_t (*test)(state_8080*, int32_t) = NULL;
+	uint64_t frames = 3600;
+	uint64_t interval = CPU_HZ / FRAME_HZ;
+	uint32_t context = CONTEXT_RECORDS;
+	const char *paths[2] = { NULL, NULL };
+	uint32_t files = 0;
+
+	for(int i = 1; i < argc; i++){
+		if(strcmp(argv[i], "-cores") == 0 && i + 2 < argc){
+			ref = find_core(argv[++i]);
+			test = find_core(argv[++i]);
+			if(ref == NULL || test == NULL){
+				printf("ERROR: unknown core, use op, run, cached or jit\n");
+				return 2;
+			}
+		}
+		else if(strcmp(argv[i], "-frames") == 0 && i + 1 < argc){
+			frames = strtoull(argv[++i], NULL, 10);
+		}
+		else if(strcmp(argv[i], "-checkpoint") == 0 && i + 1 < argc){
+			interval = strtoull(argv[++i], NULL, 10);
+		}
+		else if(strcmp(argv[i], "-context") == 0 && i + 1 < argc){
+			context = strtoul(argv[++i], NULL, 10);
+		}
+		else if(files < 2){
+			paths[files++] = argv[i];
+		}
+	}
+
+	if(ref != NULL && interval != 0){
+		return lockstep(ref, test, frames, interval, context);
+	}
+	if(files == 2){
+		return compare_traces(paths[0], paths[1], context);
+	}
+	printf("Usage: %s [-context n] <trace a> <trace b>\n", argv[0]);
+	printf("       %s -cores ref test [-frames n] [-checkpoint cycles] [-context n]\n", argv[0]);
+	printf("Cores: op, run, cached, jit\n");
+	return 2;
+}
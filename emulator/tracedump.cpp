@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trace.h"
+
+/*
+	Prints the instructions of a trace file (--trace of the drivers, -trace of the exerciser),
+	oldest first, with the registers before each instruction.
+
+	-pc takes an address or a range (0a93-0ab6), -op an opcode in hex, -from and -to a cycle
+	range. -last prints only the last n records that pass the filters, to see what led to a crash.
+
+	Usage: tracedump [-last n] [-pc addr[-addr]] [-op xx] [-from cycle] [-to cycle] <trace file>
+*/
+
+/**
+	Record filters from the command line.
+*/
+typedef struct filter{
+	uint16_t pc_low;
+	uint16_t pc_high;
+	int32_t op;			// -1 for any
+	uint64_t from;
+	uint64_t to;
+} filter;
+
+/**
+	@param f: the filters
+	@param r: a record
+	@return 1 if the record passes all filters
+*/
+static uint8_t matches(const filter *f, const trace_record *r){
+	return r->pc >= f->pc_low && r->pc <= f->pc_high && (f->op < 0 || r->op[0] == f->op) &&
+		   r->cycle >= f->from && r->cycle <= f->to;
+}
+
+int main(int argc, char **argv){
+	filter f = { 0x0000, 0xffff, -1, 0, UINT64_MAX };
+	uint64_t last = 0;
+	const char *path = NULL;
+
+	for(int i = 1; i < argc; i++){
+		if(strcmp(argv[i], "-last") == 0 && i + 1 < argc){
+			last = strtoull(argv[++i], NULL, 10);
+		}
+		else if(strcmp(argv[i], "-pc") == 0 && i + 1 < argc){
+			char *end;
+			f.pc_low = strtoul(argv[++i], &end, 16);
+			f.pc_high = *end == '-' ? strtoul(end + 1, NULL, 16) : f.pc_low;
+		}
+		else if(strcmp(argv[i], "-op") == 0 && i + 1 < argc){
+			f.op = strtoul(argv[++i], NULL, 16) & 0xff;
+		}
+		else if(strcmp(argv[i], "-from") == 0 && i + 1 < argc){
+			f.from = strtoull(argv[++i], NULL, 10);
+		}
+		else if(strcmp(argv[i], "-to") == 0 && i + 1 < argc){
+			f.to = strtoull(argv[++i], NULL, 10);
+		}
+		else{
+			path = argv[i];
+		}
+	}
+	if(path == NULL){
+		printf("Usage: %s [-last n] [-pc addr[-addr]] [-op xx] [-from cycle] [-to cycle] <trace file>\n", argv[0]);
+		return 1;
+	}
+
+	trace *t = trace_open(path);
+	if(t == NULL){
+		return 1;
+	}
+	uint64_t first = trace_first(t);
+	uint64_t count = t->header->count;
+
+	uint64_t skip = 0;
+	if(last != 0){
+		uint64_t matched = 0;
+		for(uint64_t i = first; i < count; i++){
+			matched += matches(&f, trace_get(t, i));
+		}
+		skip = matched > last ? matched - last : 0;
+	}
+
+	for(uint64_t i = first; i < count; i++){
+		const trace_record *r = trace_get(t, i);
+		if(!matches(&f, r)){
+			continue;
+		}
+		if(skip != 0){
+			skip--;
+			continue;
+		}
+		trace_print(r);
+	}
+	printf("%llu instructions traced, %llu kept\n", (unsigned long long)count, (unsigned long long)(count - first));
+
+	trace_destroy(t);
+	return 0;
+}
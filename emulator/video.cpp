@@ -0,0 +1,353 @@
+#include <stdint.h>
+#include <string.h>
+#include "video.h"
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/*
+	The VRAM holds the screen as the monitor is mounted, rotated: every 32 bytes are a column of the
+	upright image, from the bottom up, bit 0 of a byte being the lowest of its 8 pixels. Converting
+	it is a transpose.
+
+	The scalar kernel expands each byte through a table into 8 pixels of its column. The SIMD kernels
+	load 16x16 byte tiles (16 bytes of 16 columns), transpose them in registers so a register holds
+	one byte of each of the 16 columns, and then turn every bit of those bytes into a row of 16
+	pixels written with aligned vector stores.
+
+	video_update_bytes skips the transpose for renderers that rotate the image themselves: it keeps
+	the VRAM orientation, so every VRAM byte becomes 8 bytes in a row through a table.
+*/
+
+/**
+	ARGB8888 pixels of every VRAM byte, bit 0 first.
+*/
+struct pixel_table{
+	uint32_t pixels[256][8];
+};
+
+/**
+	Builds the pixel table at compile time.
+*/
+static constexpr pixel_table make_pixel_table(){
+	pixel_table table = {};
+	for(uint32_t byte = 0; byte < 256; byte++){
+		for(uint32_t bit = 0; bit < 8; bit++){
+			table.pixels[byte][bit] = (byte >> bit) & 1 ? VIDEO_ON : VIDEO_OFF;
+		}
+	}
+	return table;
+}
+
+static constexpr pixel_table expand = make_pixel_table();
+
+/**
+	One byte per pixel of every VRAM byte, bit 0 first, for the unrotated image.
+*/
+struct byte_table{
+	uint8_t pixels[256][8];
+};
+
+/**
+	Builds the byte table at compile time.
+*/
+static constexpr byte_table make_byte_table(){
+	byte_table table = {};
+	for(uint32_t byte = 0; byte < 256; byte++){
+		for(uint32_t bit = 0; bit < 8; bit++){
+			table.pixels[byte][bit] = (byte >> bit) & 1 ? VIDEO_BYTE_ON : VIDEO_BYTE_OFF;
+		}
+	}
+	return table;
+}
+
+static constexpr byte_table expand_bytes = make_byte_table();
+
+static uint8_t current = VIDEO_KERNELS;	// kernel in use, picked on the first conversion
+
+/**
+	Scalar kernel: every byte goes through the pixel table into 8 pixels of its column.
+	@param vram: Space Invaders screen memory map
+	@param pixels: VIDEO_WIDTH*VIDEO_HEIGHT pixels, row by row
+	@param first: first column to convert
+	@param end: column after the last one to convert
+*/
+static void update_scalar(const uint8_t *vram, uint32_t *pixels, uint32_t first, uint32_t end){
+	vram += first * (VIDEO_HEIGHT / 8);
+	for(uint32_t column = first; column < end; column++){
+		uint32_t *out = pixels + (VIDEO_HEIGHT - 1) * VIDEO_WIDTH + column;	// bottom row
+		for(uint32_t i = 0; i < VIDEO_HEIGHT / 8; i++){
+			const uint32_t *p = expand.pixels[*vram++];
+			out[0] = p[0];
+			out[-1 * VIDEO_WIDTH] = p[1];
+			out[-2 * VIDEO_WIDTH] = p[2];
+			out[-3 * VIDEO_WIDTH] = p[3];
+			out[-4 * VIDEO_WIDTH] = p[4];
+			out[-5 * VIDEO_WIDTH] = p[5];
+			out[-6 * VIDEO_WIDTH] = p[6];
+			out[-7 * VIDEO_WIDTH] = p[7];
+			out -= 8 * VIDEO_WIDTH;
+		}
+	}
+}
+
+#if defined(__SSE2__)
+
+/**
+	Loads a tile and transposes it: four rounds of interleaving, bytes, then 16, 32 and 64 bit
+	lanes, move byte k of column c to byte c of row k.
+	@param vram: first byte of the tile, in its first column
+	@param rows: byte k of the 16 columns for each k
+*/
+static inline void load_tile(const uint8_t *vram, __m128i rows[VIDEO_TILE]){
+	__m128i t[VIDEO_TILE];
+	for(uint32_t c = 0; c < VIDEO_TILE; c++){
+		rows[c] = _mm_loadu_si128((const __m128i*)(vram + c * (VIDEO_HEIGHT / 8)));
+	}
+	for(uint32_t i = 0; i < VIDEO_TILE / 2; i++){
+		t[i] = _mm_unpacklo_epi8(rows[2 * i], rows[2 * i + 1]);
+		t[i + VIDEO_TILE / 2] = _mm_unpackhi_epi8(rows[2 * i], rows[2 * i + 1]);
+	}
+	for(uint32_t i = 0; i < VIDEO_TILE / 2; i++){
+		rows[i] = _mm_unpacklo_epi16(t[2 * i], t[2 * i + 1]);
+		rows[i + VIDEO_TILE / 2] = _mm_unpackhi_epi16(t[2 * i], t[2 * i + 1]);
+	}
+	for(uint32_t i = 0; i < VIDEO_TILE / 2; i++){
+		t[i] = _mm_unpacklo_epi32(rows[2 * i], rows[2 * i + 1]);
+		t[i + VIDEO_TILE / 2] = _mm_unpackhi_epi32(rows[2 * i], rows[2 * i + 1]);
+	}
+	// the interleaving leaves the bytes in bit reversed order
+	static const uint8_t order[VIDEO_TILE] = { 0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15 };
+	for(uint32_t i = 0; i < VIDEO_TILE / 2; i++){
+		rows[order[i]] = _mm_unpacklo_epi64(t[2 * i], t[2 * i + 1]);
+		rows[order[i + VIDEO_TILE / 2]] = _mm_unpackhi_epi64(t[2 * i], t[2 * i + 1]);
+	}
+}
+
+/**
+	SSE2 kernel.
+	@param vram: Space Invaders screen memory map
+	@param pixels: VIDEO_WIDTH*VIDEO_HEIGHT pixels, row by row, VIDEO_ALIGN aligned
+	@param first: first column to convert, a multiple of VIDEO_TILE
+	@param end: column after the last one to convert, a multiple of VIDEO_TILE
+*/
+static void update_sse2(const uint8_t *vram, uint32_t *pixels, uint32_t first, uint32_t end){
+	const __m128i on = _mm_set1_epi32(VIDEO_ON);
+	const __m128i off = _mm_set1_epi32(VIDEO_OFF);
+	__m128i rows[VIDEO_TILE];
+
+	for(uint32_t column = first; column < end; column += VIDEO_TILE){
+		for(uint32_t byte = 0; byte < VIDEO_HEIGHT / 8; byte += VIDEO_TILE){
+			load_tile(vram + column * (VIDEO_HEIGHT / 8) + byte, rows);
+			for(uint32_t k = 0; k < VIDEO_TILE; k++){
+				for(uint32_t bit = 0; bit < 8; bit++){
+					__m128i mask = _mm_set1_epi8((char)(1 << bit));
+					__m128i lit = _mm_cmpeq_epi8(_mm_and_si128(rows[k], mask), mask);
+					__m128i low = _mm_unpacklo_epi8(lit, lit);
+					__m128i high = _mm_unpackhi_epi8(lit, lit);
+					__m128i p[4] = { _mm_unpacklo_epi16(low, low), _mm_unpackhi_epi16(low, low),
+									 _mm_unpacklo_epi16(high, high), _mm_unpackhi_epi16(high, high) };
+
+					uint32_t y = VIDEO_HEIGHT - 1 - (8 * (byte + k) + bit);
+					__m128i *out = (__m128i*)(pixels + y * VIDEO_WIDTH + column);
+					for(uint32_t i = 0; i < 4; i++){
+						_mm_store_si128(out + i, _mm_or_si128(_mm_and_si128(p[i], on), _mm_andnot_si128(p[i], off)));
+					}
+				}
+			}
+		}
+	}
+}
+
+/**
+	AVX2 kernel, the SSE2 transpose with the pixels widened and stored 8 at a time.
+	@param vram: Space Invaders screen memory map
+	@param pixels: VIDEO_WIDTH*VIDEO_HEIGHT pixels, row by row, VIDEO_ALIGN aligned
+	@param first: first column to convert, a multiple of VIDEO_TILE
+	@param end: column after the last one to convert, a multiple of VIDEO_TILE
+*/
+__attribute__((target("avx2"))) static void update_avx2(const uint8_t *vram, uint32_t *pixels, uint32_t first, uint32_t end){
+	const __m256i on = _mm256_set1_epi32(VIDEO_ON);
+	const __m256i off = _mm256_set1_epi32(VIDEO_OFF);
+	__m128i rows[VIDEO_TILE];
+
+	for(uint32_t column = first; column < end; column += VIDEO_TILE){
+		for(uint32_t byte = 0; byte < VIDEO_HEIGHT / 8; byte += VIDEO_TILE){
+			load_tile(vram + column * (VIDEO_HEIGHT / 8) + byte, rows);
+			for(uint32_t k = 0; k < VIDEO_TILE; k++){
+				for(uint32_t bit = 0; bit < 8; bit++){
+					__m128i mask = _mm_set1_epi8((char)(1 << bit));
+					__m128i lit = _mm_cmpeq_epi8(_mm_and_si128(rows[k], mask), mask);
+					// sign extension turns the 0xff bytes into 0xffffffff lanes
+					__m256i low = _mm256_cvtepi8_epi32(lit);
+					__m256i high = _mm256_cvtepi8_epi32(_mm_srli_si128(lit, 8));
+
+					uint32_t y = VIDEO_HEIGHT - 1 - (8 * (byte + k) + bit);
+					__m256i *out = (__m256i*)(pixels + y * VIDEO_WIDTH + column);
+					_mm256_store_si256(out, _mm256_blendv_epi8(off, on, low));
+					_mm256_store_si256(out + 1, _mm256_blendv_epi8(off, on, high));
+				}
+			}
+		}
+	}
+}
+
+#endif
+
+/**
+	@param kernel: a kernel (enum video_kernel)
+	@return 1 if the host can run it
+*/
+uint8_t video_kernel_supported(uint8_t kernel){
+	switch(kernel){
+		case VIDEO_SCALAR:
+			return 1;
+#if defined(__SSE2__)
+		case VIDEO_SSE2:
+			return 1;
+		case VIDEO_AVX2:
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx2") != 0;
+#endif
+	}
+	return 0;
+}
+
+/**
+	@param kernel: a kernel (enum video_kernel)
+	@return its name
+*/
+const char *video_kernel_name(uint8_t kernel){
+	static const char *names[VIDEO_KERNELS] = { "scalar", "sse2", "avx2" };
+	return kernel < VIDEO_KERNELS ? names[kernel] : "none";
+}
+
+/**
+	@return the kernel video_update_surface uses, the fastest the host supports unless one was set
+*/
+uint8_t video_get_kernel(){
+	if(current == VIDEO_KERNELS){
+		current = VIDEO_SCALAR;
+		for(uint8_t kernel = VIDEO_SCALAR; kernel < VIDEO_KERNELS; kernel++){
+			if(video_kernel_supported(kernel)){
+				current = kernel;
+			}
+		}
+	}
+	return current;
+}
+
+/**
+	Picks the kernel video_update_surface uses, to compare them.
+	@param kernel: a kernel (enum video_kernel)
+	@return 0 if the host can't run it, the kernel in use doesn't change then
+*/
+uint8_t video_set_kernel(uint8_t kernel){
+	if(!video_kernel_supported(kernel)){
+		return 0;
+	}
+	current = kernel;
+	return 1;
+}
+
+/**
+	Converts a range of columns with the kernel in use.
+	@param vram: Space Invaders screen memory map
+	@param pixels: VIDEO_WIDTH*VIDEO_HEIGHT pixels, row by row
+	@param first: first column to convert, a multiple of VIDEO_TILE
+	@param end: column after the last one to convert, a multiple of VIDEO_TILE
+*/
+static void update_columns(const uint8_t *vram, uint32_t *pixels, uint32_t first, uint32_t end){
+	uint8_t kernel = video_get_kernel();
+	if((uintptr_t)pixels % VIDEO_ALIGN != 0){
+		kernel = VIDEO_SCALAR;
+	}
+
+	switch(kernel){
+#if defined(__SSE2__)
+		case VIDEO_AVX2:
+			update_avx2(vram, pixels, first, end);
+			break;
+		case VIDEO_SSE2:
+			update_sse2(vram, pixels, first, end);
+			break;
+#endif
+		default:
+			update_scalar(vram, pixels, first, end);
+			break;
+	}
+}
+
+/**
+	Translates the memory mapped video RAM to an upright ARGB8888 image. No SDL needed, so the
+	conversion can be used and measured on headless hosts.
+	@param vram: Space Invaders screen memory map
+	@param pixels: VIDEO_WIDTH*VIDEO_HEIGHT pixels, row by row. The SIMD kernels need it VIDEO_ALIGN
+				   aligned, the scalar kernel is used otherwise
+*/
+void video_update_surface(const uint8_t *vram, uint32_t *pixels){
+	update_columns(vram, pixels, 0, VIDEO_WIDTH);
+}
+
+/**
+	Merges the tiles of VIDEO_TILE columns that have a column written into spans.
+	@param dirty: VIDEO_WIDTH bits, 1 for the columns written
+	@param spans: filled with the dirty tiles, at most VIDEO_MAX_SPANS
+	@return the number of spans
+*/
+static uint32_t dirty_spans(const uint32_t *dirty, video_span *spans){
+	uint32_t count = 0;
+	for(uint32_t tile = 0; tile < VIDEO_WIDTH; tile += VIDEO_TILE){
+		if(((dirty[tile / 32] >> (tile % 32)) & ((1u << VIDEO_TILE) - 1)) == 0){
+			continue;
+		}
+		// neighbouring tiles make one span
+		if(count > 0 && spans[count - 1].end == tile){
+			spans[count - 1].end = tile + VIDEO_TILE;
+		}
+		else{
+			spans[count].first = tile;
+			spans[count].end = tile + VIDEO_TILE;
+			count++;
+		}
+	}
+	return count;
+}
+
+/**
+	Converts only the tiles of VIDEO_TILE columns that have a column written since the last
+	conversion, and returns them as spans of columns to upload.
+	@param vram: Space Invaders screen memory map
+	@param pixels: VIDEO_WIDTH*VIDEO_HEIGHT pixels, row by row, holding the previous conversion
+	@param dirty: VIDEO_WIDTH bits, 1 for the columns written since the previous conversion
+	@param spans: filled with the converted columns, at most VIDEO_MAX_SPANS
+	@return the number of spans, 0 if nothing changed
+*/
+uint32_t video_update_dirty(const uint8_t *vram, uint32_t *pixels, const uint32_t *dirty, video_span *spans){
+	uint32_t count = dirty_spans(dirty, spans);
+	for(uint32_t i = 0; i < count; i++){
+		update_columns(vram, pixels, spans[i].first, spans[i].end);
+	}
+	return count;
+}
+
+/**
+	Expands the tiles with a column written since the last conversion to one byte per pixel,
+	without rotating: column c of the upright image is row c of a VIDEO_HEIGHT wide image, for
+	the renderer to rotate when presenting.
+	@param vram: Space Invaders screen memory map
+	@param pixels: VIDEO_HEIGHT*VIDEO_WIDTH bytes, VIDEO_WIDTH rows of VIDEO_HEIGHT, holding the
+				   previous conversion
+	@param dirty: VIDEO_WIDTH bits, 1 for the columns written since the previous conversion
+	@param spans: filled with the converted rows (columns of the upright image), at most VIDEO_MAX_SPANS
+	@return the number of spans, 0 if nothing changed
+*/
+uint32_t video_update_bytes(const uint8_t *vram, uint8_t *pixels, const uint32_t *dirty, video_span *spans){
+	uint32_t count = dirty_spans(dirty, spans);
+	for(uint32_t i = 0; i < count; i++){
+		for(uint32_t byte = spans[i].first * (VIDEO_HEIGHT / 8); byte < spans[i].end * (VIDEO_HEIGHT / 8); byte++){
+			memcpy(pixels + byte * 8, expand_bytes.pixels[vram[byte]], 8);
+		}
+	}
+	return count;
+}
@@ -0,0 +1,90 @@
+#include <stdint.h>
+
+#pragma once
+
+// size of the screen, rotated upright like the cabinet monitor
+#define VIDEO_WIDTH 224
+#define VIDEO_HEIGHT 256
+
+// ARGB8888 colours of lit and dark pixels
+#define VIDEO_ON 0xFFFFFF
+#define VIDEO_OFF 0
+
+// RGB332 colours of lit and dark pixels, for the unrotated one byte per pixel image
+#define VIDEO_BYTE_ON 0xFF
+#define VIDEO_BYTE_OFF 0
+
+// alignment of the image the SIMD kernels write with aligned stores
+#define VIDEO_ALIGN 32
+
+// columns converted together, the tile width of the SIMD kernels
+#define VIDEO_TILE 16
+#define VIDEO_MAX_SPANS (VIDEO_WIDTH / VIDEO_TILE)
+
+// conversion kernels, the fastest the host supports is picked at the first conversion
+enum video_kernel{ VIDEO_SCALAR, VIDEO_SSE2, VIDEO_AVX2, VIDEO_KERNELS };
+
+/**
+	Translates the memory mapped video RAM to an upright ARGB8888 image. No SDL needed, so the
+	conversion can be used and measured on headless hosts.
+	@param vram: Space Invaders screen memory map
+	@param pixels: VIDEO_WIDTH*VIDEO_HEIGHT pixels, row by row. The SIMD kernels need it VIDEO_ALIGN
+				   aligned, the scalar kernel is used otherwise
+*/
+void video_update_surface(const uint8_t *vram, uint32_t *pixels);
+
+/**
+	Columns of the image, from first to end - 1.
+*/
+typedef struct video_span{
+	uint16_t first;
+	uint16_t end;
+} video_span;
+
+/**
+	Converts only the tiles of VIDEO_TILE columns that have a column written since the last
+	conversion, and returns them as spans of columns to upload.
+	@param vram: Space Invaders screen memory map
+	@param pixels: VIDEO_WIDTH*VIDEO_HEIGHT pixels, row by row, holding the previous conversion
+	@param dirty: VIDEO_WIDTH bits, 1 for the columns written since the previous conversion
+	@param spans: filled with the converted columns, at most VIDEO_MAX_SPANS
+	@return the number of spans, 0 if nothing changed
+*/
+uint32_t video_update_dirty(const uint8_t *vram, uint32_t *pixels, const uint32_t *dirty, video_span *spans);
+
+/**
+	Expands the tiles with a column written since the last conversion to one byte per pixel,
+	without rotating: column c of the upright image is row c of a VIDEO_HEIGHT wide image, for
+	the renderer to rotate when presenting.
+	@param vram: Space Invaders screen memory map
+	@param pixels: VIDEO_HEIGHT*VIDEO_WIDTH bytes, VIDEO_WIDTH rows of VIDEO_HEIGHT, holding the
+				   previous conversion
+	@param dirty: VIDEO_WIDTH bits, 1 for the columns written since the previous conversion
+	@param spans: filled with the converted rows (columns of the upright image), at most VIDEO_MAX_SPANS
+	@return the number of spans, 0 if nothing changed
+*/
+uint32_t video_update_bytes(const uint8_t *vram, uint8_t *pixels, const uint32_t *dirty, video_span *spans);
+
+/**
+	@param kernel: a kernel (enum video_kernel)
+	@return 1 if the host can run it
+*/
+uint8_t video_kernel_supported(uint8_t kernel);
+
+/**
+	@param kernel: a kernel (enum video_kernel)
+	@return its name
+*/
+const char *video_kernel_name(uint8_t kernel);
+
+/**
+	@return the kernel video_update_surface uses, the fastest the host supports unless one was set
+*/
+uint8_t video_get_kernel();
+
+/**
+	Picks the kernel video_update_surface uses, to compare them.
+	@param kernel: a kernel (enum video_kernel)
+	@return 0 if the host can't run it, the kernel in use doesn't change then
+*/
+uint8_t video_set_kernel(uint8_t kernel);